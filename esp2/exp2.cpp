@@ -1,88 +1,385 @@
 #include <iostream>
 #include <vector>
-#include <queue>
 #include <algorithm>
 #include <cctype>
 #include <map>
 #include <cstring>
+#include <cstdio>
 #include <iomanip>
 #include <string>
+#include <ctime>
+#include <chrono>
+#include <thread>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
+// 64位字的位运算辅助函数
+inline int popcount64(unsigned long long w)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(w);
+#else
+    w = w - ((w >> 1) & 0x5555555555555555ULL);
+    w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+    w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (int)((w * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// 前导零个数（w != 0）
+inline int clz64(unsigned long long w)
+{
+#if defined(__GNUC__)
+    return __builtin_clzll(w);
+#else
+    int n = 0;
+    while (!(w & 0x8000000000000000ULL))
+    {
+        w <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+// 64位字按位反转（第0位与第63位交换……）
+inline unsigned long long reverse64(unsigned long long w)
+{
+    w = ((w >> 1) & 0x5555555555555555ULL) | ((w & 0x5555555555555555ULL) << 1);
+    w = ((w >> 2) & 0x3333333333333333ULL) | ((w & 0x3333333333333333ULL) << 2);
+    w = ((w >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((w & 0x0f0f0f0f0f0f0f0fULL) << 4);
+    w = ((w >> 8) & 0x00ff00ff00ff00ffULL) | ((w & 0x00ff00ff00ff00ffULL) << 8);
+    w = ((w >> 16) & 0x0000ffff0000ffffULL) | ((w & 0x0000ffff0000ffffULL) << 16);
+    return (w >> 32) | (w << 32);
+}
+
 // 位图类，用于高效表示二进制序列
+// 以64位字存储，第k位位于第k/64个字中从高位数起的第k%64位，与Huffman码流的读写顺序一致
+// 支持rank/select（基于分块的rank目录和采样的select索引）、下一个置位查找和整字批量集合运算
 class Bitmap
 {
 private:
-    unsigned char *M; // 位图存储空间
-    size_t N;         // 位图空间大小（单位：字节）
-    size_t _sz;       // 有效位数
+    static const size_t BLOCK_WORDS = 8;     // rank目录每块8个字（512位）
+    static const size_t SELECT_SAMPLE = 512; // 每512个置位记录一次所在块
+
+    unsigned long long *M; // 位图存储空间
+    size_t N;              // 位图空间大小（单位：64位字）
+    size_t _sz;            // 置位的个数
+
+    // rank/select索引，位图修改后在下次查询时重建
+    mutable vector<size_t> rankDir;       // rankDir[b]：第b块之前的置位数
+    mutable vector<size_t> selectSamples; // selectSamples[i]：第i*SELECT_SAMPLE个置位所在的块
+    mutable bool dirty;
 
     void init(size_t n)
     {
-        N = (n + 7) / 8;
-        M = new unsigned char[N];
-        memset(M, 0, N);
+        N = max<size_t>(1, (n + 63) / 64);
+        M = new unsigned long long[N];
+        memset(M, 0, N * sizeof(unsigned long long));
         _sz = 0;
+        dirty = true;
     }
 
-    // 非const方法，用于扩展位图
+    // 扩展到能容纳第k位，容量至少翻倍，均摊O(1)
     void expand(size_t k)
     {
-        if (k < 8 * N)
+        if (k < 64 * N)
             return;
-        size_t oldN = N;
-        unsigned char *oldM = M;
-        init(2 * k);
-        memcpy(M, oldM, oldN);
-        delete[] oldM;
+        size_t newN = max(2 * N, k / 64 + 1);
+        unsigned long long *newM = new unsigned long long[newN];
+        memcpy(newM, M, N * sizeof(unsigned long long));
+        memset(newM + N, 0, (newN - N) * sizeof(unsigned long long));
+        delete[] M;
+        M = newM;
+        N = newN;
+    }
+
+    static unsigned long long mask(size_t k)
+    {
+        return 0x8000000000000000ULL >> (k & 63);
+    }
+
+    void buildIndex() const
+    {
+        size_t blocks = (N + BLOCK_WORDS - 1) / BLOCK_WORDS;
+        rankDir.assign(blocks + 1, 0);
+        selectSamples.clear();
+        size_t ones = 0;
+        for (size_t b = 0; b < blocks; b++)
+        {
+            rankDir[b] = ones;
+            size_t end = min(N, (b + 1) * BLOCK_WORDS);
+            for (size_t w = b * BLOCK_WORDS; w < end; w++)
+                ones += popcount64(M[w]);
+            // 记录本块内出现的采样置位
+            while (selectSamples.size() * SELECT_SAMPLE < ones)
+                selectSamples.push_back(b);
+        }
+        rankDir[blocks] = ones;
+        dirty = false;
+    }
+
+    // 批量集合运算：op逐字作用于两个位图的公共部分
+    template <typename Op>
+    void combine(const Bitmap &other, Op op, bool growToOther)
+    {
+        if (growToOther && other.N > N)
+            expand(64 * other.N - 1);
+        size_t n = min(N, other.N);
+        size_t w = 0;
+#ifdef __AVX2__
+        for (; w + 4 <= n; w += 4)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(M + w));
+            __m256i b = _mm256_loadu_si256((const __m256i *)(other.M + w));
+            _mm256_storeu_si256((__m256i *)(M + w), op(a, b));
+        }
+#endif
+        for (; w < n; w++)
+            M[w] = op(M[w], other.M[w]);
+        _sz = 0;
+        for (size_t i = 0; i < N; i++)
+            _sz += popcount64(M[i]);
+        dirty = true;
     }
 
+    struct OpAnd
+    {
+        unsigned long long operator()(unsigned long long a, unsigned long long b) const { return a & b; }
+#ifdef __AVX2__
+        __m256i operator()(__m256i a, __m256i b) const { return _mm256_and_si256(a, b); }
+#endif
+    };
+    struct OpOr
+    {
+        unsigned long long operator()(unsigned long long a, unsigned long long b) const { return a | b; }
+#ifdef __AVX2__
+        __m256i operator()(__m256i a, __m256i b) const { return _mm256_or_si256(a, b); }
+#endif
+    };
+    struct OpXor
+    {
+        unsigned long long operator()(unsigned long long a, unsigned long long b) const { return a ^ b; }
+#ifdef __AVX2__
+        __m256i operator()(__m256i a, __m256i b) const { return _mm256_xor_si256(a, b); }
+#endif
+    };
+    struct OpAndNot
+    {
+        unsigned long long operator()(unsigned long long a, unsigned long long b) const { return a & ~b; }
+#ifdef __AVX2__
+        __m256i operator()(__m256i a, __m256i b) const { return _mm256_andnot_si256(b, a); }
+#endif
+    };
+
 public:
+    static const size_t npos = (size_t)-1;
+
     Bitmap(size_t n = 8)
     {
         init(n);
     }
 
+    Bitmap(const Bitmap &other)
+    {
+        init(64 * other.N);
+        memcpy(M, other.M, N * sizeof(unsigned long long));
+        _sz = other._sz;
+    }
+
+    Bitmap &operator=(const Bitmap &other)
+    {
+        if (this != &other)
+        {
+            delete[] M;
+            init(64 * other.N);
+            memcpy(M, other.M, N * sizeof(unsigned long long));
+            _sz = other._sz;
+        }
+        return *this;
+    }
+
     ~Bitmap()
     {
         delete[] M;
     }
 
+    // 置位的个数
     size_t size() const
     {
         return _sz;
     }
 
+    // 当前可容纳的位数
+    size_t capacity() const
+    {
+        return 64 * N;
+    }
+
+    // 底层存储（只读），供位流读取器按字访问
+    const unsigned long long *words() const
+    {
+        return M;
+    }
+
+    size_t wordCount() const
+    {
+        return N;
+    }
+
+    // 第w个字，越过末尾为0；与RoaringBitmap::word接口相同，供位流读取器使用
+    unsigned long long word(size_t w) const
+    {
+        return w < N ? M[w] : 0;
+    }
+
     void set(size_t k)
     {
         expand(k);
-        _sz++;
-        M[k >> 3] |= (0x80 >> (k & 0x07));
+        if (!(M[k >> 6] & mask(k)))
+        {
+            M[k >> 6] |= mask(k);
+            _sz++;
+            dirty = true;
+        }
     }
 
     void clear(size_t k)
     {
-        expand(k);
+        // 超出范围的位本来就是0，无需扩展
+        if (k >= 64 * N || !(M[k >> 6] & mask(k)))
+            return;
+        M[k >> 6] &= ~mask(k);
         _sz--;
-        M[k >> 3] &= ~(0x80 >> (k & 0x07));
+        dirty = true;
     }
 
-    // 修复1：const版本的test，只检查已存在的位，不扩展
+    // 只检查已存在的位，不扩展
     bool test(size_t k) const
     {
         // 超出当前位图范围直接返回false
-        if (k >= 8 * N)
+        if (k >= 64 * N)
             return false;
-        return (M[k >> 3] & (0x80 >> (k & 0x07))) != 0;
+        return (M[k >> 6] & mask(k)) != 0;
+    }
+
+    // 从第k位起按位或入value的低len位（高位在前），用于追加码字
+    void orBits(size_t k, unsigned long long value, int len)
+    {
+        if (len == 0)
+            return;
+        expand(k + len - 1);
+        value <<= 64 - len; // 左对齐
+        size_t w = k >> 6;
+        int off = k & 63;
+        unsigned long long hi = value >> off;
+        _sz += popcount64(hi & ~M[w]);
+        M[w] |= hi;
+        if (off + len > 64)
+        {
+            unsigned long long lo = value << (64 - off);
+            _sz += popcount64(lo & ~M[w + 1]);
+            M[w + 1] |= lo;
+        }
+        dirty = true;
+    }
+
+    // [0, k)中置位的个数
+    size_t rank(size_t k) const
+    {
+        if (dirty)
+            buildIndex();
+        if (k >= 64 * N)
+            return _sz;
+        size_t w = k >> 6;
+        size_t r = rankDir[w / BLOCK_WORDS];
+        for (size_t i = w / BLOCK_WORDS * BLOCK_WORDS; i < w; i++)
+            r += popcount64(M[i]);
+        if (k & 63)
+            r += popcount64(M[w] >> (64 - (k & 63)));
+        return r;
+    }
+
+    // 第j个（从0计）置位的位置，不存在返回npos
+    size_t select(size_t j) const
+    {
+        if (j >= _sz)
+            return npos;
+        if (dirty)
+            buildIndex();
+        // 从采样点所在块出发，沿rank目录找到目标块
+        size_t b = selectSamples[j / SELECT_SAMPLE];
+        while (rankDir[b + 1] <= j)
+            b++;
+        size_t r = j - rankDir[b];
+        size_t w = b * BLOCK_WORDS;
+        for (;; w++)
+        {
+            int c = popcount64(M[w]);
+            if ((size_t)c > r)
+                break;
+            r -= c;
+        }
+        // 在字内逐个去掉最高的置位
+        unsigned long long x = M[w];
+        for (size_t i = 0; i < r; i++)
+            x &= ~(0x8000000000000000ULL >> clz64(x));
+        return 64 * w + clz64(x);
+    }
+
+    // 不小于k的第一个置位，不存在返回npos；可用于遍历：for (k = nextSet(0); k != npos; k = nextSet(k + 1))
+    size_t nextSet(size_t k) const
+    {
+        if (k >= 64 * N)
+            return npos;
+        size_t w = k >> 6;
+        unsigned long long x = M[w] & (~0ULL >> (k & 63));
+        while (x == 0)
+        {
+            if (++w == N)
+                return npos;
+            x = M[w];
+        }
+        return 64 * w + clz64(x);
+    }
+
+    // 批量集合运算（整字进行，编译时启用AVX2则每次处理256位）
+    Bitmap &operator&=(const Bitmap &other)
+    {
+        // 超出other范围的部分与0相与
+        for (size_t w = other.N; w < N; w++)
+            M[w] = 0;
+        combine(other, OpAnd(), false);
+        return *this;
     }
 
-    // 修复2：const版本的bits2string，不扩展位图
+    Bitmap &operator|=(const Bitmap &other)
+    {
+        combine(other, OpOr(), true);
+        return *this;
+    }
+
+    Bitmap &operator^=(const Bitmap &other)
+    {
+        combine(other, OpXor(), true);
+        return *this;
+    }
+
+    Bitmap &andNot(const Bitmap &other)
+    {
+        combine(other, OpAndNot(), false);
+        return *this;
+    }
+
+    // const版本的bits2string，不扩展位图
     string bits2string(size_t n) const
     {
         string s;
-        // 只处理0~min(n-1, 8*N-1)的位，超出部分补0
-        size_t maxBit = min(n, 8 * N);
+        // 只处理0~min(n-1, 64*N-1)的位，超出部分补0
+        size_t maxBit = min(n, 64 * N);
         for (size_t i = 0; i < maxBit; i++)
         {
             s += test(i) ? '1' : '0';
@@ -95,15 +392,544 @@ public:
         return s;
     }
 
-    // 新增：非const版本，允许扩展后生成字符串（供需要扩展的场景）
+    // 非const版本，允许扩展后生成字符串（供需要扩展的场景）
     string bits2string_and_expand(size_t n)
     {
-        if (n > 8 * N)
+        if (n > 64 * N)
             expand(n - 1);
         return bits2string(n);
     }
 };
 
+// 压缩位图（Roaring结构）：32位键空间按高16位分块，每块按密度选用有序数组、普通位图或游程表
+// 对外提供与Bitmap相同的set/clear/test/size/bits2string接口，可直接替换
+class RoaringBitmap
+{
+private:
+    static const unsigned ARRAY_MAX = 4096; // 数组容器的最大基数，超过则转为位图容器（8KB）
+    static const unsigned CHUNK_WORDS = 1024;
+
+    enum Kind
+    {
+        ARRAY,
+        BITSET,
+        RUN
+    };
+
+    struct Container
+    {
+        Kind kind;
+        unsigned card;                                   // 块内置位个数
+        vector<unsigned short> array;                    // ARRAY：有序的低16位
+        vector<unsigned long long> bits;                 // BITSET：65536位，低位在前
+        vector<pair<unsigned short, unsigned short>> runs; // RUN：(起点, 长度-1)
+
+        Container() : kind(ARRAY), card(0) {}
+    };
+
+    vector<unsigned short> keys; // 各容器的高16位，有序
+    vector<Container> containers;
+    size_t _sz;
+
+    // 查找键所在的容器下标，不存在返回-1
+    int findContainer(unsigned short key) const
+    {
+        auto it = lower_bound(keys.begin(), keys.end(), key);
+        if (it == keys.end() || *it != key)
+            return -1;
+        return it - keys.begin();
+    }
+
+    Container &getOrCreate(unsigned short key)
+    {
+        auto it = lower_bound(keys.begin(), keys.end(), key);
+        size_t idx = it - keys.begin();
+        if (it == keys.end() || *it != key)
+        {
+            keys.insert(it, key);
+            containers.insert(containers.begin() + idx, Container());
+        }
+        return containers[idx];
+    }
+
+    void removeContainer(int idx)
+    {
+        keys.erase(keys.begin() + idx);
+        containers.erase(containers.begin() + idx);
+    }
+
+    static void toWords(const Container &c, vector<unsigned long long> &w)
+    {
+        if (c.kind == BITSET)
+        {
+            w = c.bits;
+            return;
+        }
+        w.assign(CHUNK_WORDS, 0);
+        if (c.kind == ARRAY)
+        {
+            for (unsigned short v : c.array)
+                w[v >> 6] |= 1ULL << (v & 63);
+        }
+        else
+        {
+            for (auto &r : c.runs)
+                for (unsigned v = r.first; v <= (unsigned)r.first + r.second; v++)
+                    w[v >> 6] |= 1ULL << (v & 63);
+        }
+    }
+
+    static void toArray(const Container &c, vector<unsigned short> &a)
+    {
+        a.clear();
+        if (c.kind == ARRAY)
+        {
+            a = c.array;
+        }
+        else if (c.kind == RUN)
+        {
+            for (auto &r : c.runs)
+                for (unsigned v = r.first; v <= (unsigned)r.first + r.second; v++)
+                    a.push_back(v);
+        }
+        else
+        {
+            for (unsigned w = 0; w < CHUNK_WORDS; w++)
+                for (unsigned long long x = c.bits[w]; x; x &= x - 1)
+                    a.push_back(w * 64 + popcount64((x & (0 - x)) - 1)); // 最低置位的下标
+        }
+    }
+
+    // 按基数选择数组或位图表示（游程表示只由runOptimize生成）
+    static void normalize(Container &c)
+    {
+        if (c.card <= ARRAY_MAX && c.kind != ARRAY)
+        {
+            vector<unsigned short> a;
+            toArray(c, a);
+            c.array.swap(a);
+            c.bits.clear();
+            c.runs.clear();
+            c.kind = ARRAY;
+        }
+        else if (c.card > ARRAY_MAX && c.kind != BITSET)
+        {
+            vector<unsigned long long> w;
+            toWords(c, w);
+            c.bits.swap(w);
+            c.array.clear();
+            c.runs.clear();
+            c.kind = BITSET;
+        }
+    }
+
+    static bool containsLow(const Container &c, unsigned short low)
+    {
+        if (c.kind == ARRAY)
+            return binary_search(c.array.begin(), c.array.end(), low);
+        if (c.kind == BITSET)
+            return (c.bits[low >> 6] >> (low & 63)) & 1;
+        // 找到起点不超过low的最后一个游程
+        auto it = upper_bound(c.runs.begin(), c.runs.end(), make_pair(low, (unsigned short)0xffff));
+        if (it == c.runs.begin())
+            return false;
+        --it;
+        return low <= (unsigned)it->first + it->second;
+    }
+
+    void recount()
+    {
+        _sz = 0;
+        for (auto &c : containers)
+            _sz += c.card;
+    }
+
+public:
+    RoaringBitmap(size_t = 0) : _sz(0) {} // 参数仅为与Bitmap构造接口兼容
+
+    size_t size() const
+    {
+        return _sz;
+    }
+
+    void set(size_t k)
+    {
+        if (k >> 32)
+            throw "RoaringBitmap只支持32位下标";
+        Container &c = getOrCreate(k >> 16);
+        unsigned short low = k & 0xffff;
+        if (c.kind == RUN) // 游程容器先展开再修改
+        {
+            vector<unsigned short> a;
+            toArray(c, a);
+            c.runs.clear();
+            c.array.swap(a);
+            c.kind = ARRAY;
+            normalize(c);
+        }
+        if (c.kind == ARRAY)
+        {
+            auto it = lower_bound(c.array.begin(), c.array.end(), low);
+            if (it != c.array.end() && *it == low)
+                return;
+            c.array.insert(it, low);
+        }
+        else
+        {
+            unsigned long long &w = c.bits[low >> 6];
+            if (w & (1ULL << (low & 63)))
+                return;
+            w |= 1ULL << (low & 63);
+        }
+        c.card++;
+        _sz++;
+        normalize(c);
+    }
+
+    void clear(size_t k)
+    {
+        int idx = findContainer(k >> 16);
+        if (idx < 0 || !test(k))
+            return;
+        Container &c = containers[idx];
+        unsigned short low = k & 0xffff;
+        if (c.kind == RUN)
+        {
+            vector<unsigned short> a;
+            toArray(c, a);
+            c.runs.clear();
+            c.array.swap(a);
+            c.kind = ARRAY;
+            normalize(c);
+        }
+        if (c.kind == ARRAY)
+            c.array.erase(lower_bound(c.array.begin(), c.array.end(), low));
+        else
+            c.bits[low >> 6] &= ~(1ULL << (low & 63));
+        c.card--;
+        _sz--;
+        if (c.card == 0)
+            removeContainer(idx);
+        else
+            normalize(c);
+    }
+
+    bool test(size_t k) const
+    {
+        if (k >> 32)
+            return false;
+        int idx = findContainer(k >> 16);
+        return idx >= 0 && containsLow(containers[idx], k & 0xffff);
+    }
+
+    // 第w个64位字，位序与Bitmap相同（第w*64位在最高位），供位流读取器按字访问
+    unsigned long long word(size_t w) const
+    {
+        if (w >> 26)
+            return 0;
+        int idx = findContainer(w >> 10);
+        if (idx < 0)
+            return 0;
+        const Container &c = containers[idx];
+        unsigned lo = (unsigned)(w & 1023) << 6, hi = lo + 63;
+        unsigned long long r = 0; // 低位在前，最后反转
+        if (c.kind == BITSET)
+            r = c.bits[w & 1023];
+        else if (c.kind == ARRAY)
+        {
+            for (auto it = lower_bound(c.array.begin(), c.array.end(), (unsigned short)lo); it != c.array.end() && *it <= hi; ++it)
+                r |= 1ULL << (*it - lo);
+        }
+        else
+        {
+            auto it = upper_bound(c.runs.begin(), c.runs.end(), make_pair((unsigned short)lo, (unsigned short)0xffff));
+            if (it != c.runs.begin())
+                --it;
+            for (; it != c.runs.end() && it->first <= hi; ++it)
+            {
+                unsigned a = max((unsigned)it->first, lo), b = min((unsigned)it->first + it->second, hi);
+                for (unsigned v = a; v <= b; v++)
+                    r |= 1ULL << (v - lo);
+            }
+        }
+        return reverse64(r);
+    }
+
+    // 从第k位起按位或入value的低len位（高位在前），与Bitmap::orBits语义一致
+    void orBits(size_t k, unsigned long long value, int len)
+    {
+        for (int i = 0; i < len; i++)
+        {
+            if ((value >> (len - 1 - i)) & 1)
+                set(k + i);
+        }
+    }
+
+    // 把游程更省空间的容器转为游程表示（适合大段连续置位）
+    void runOptimize()
+    {
+        for (auto &c : containers)
+        {
+            vector<unsigned short> a;
+            toArray(c, a);
+            vector<pair<unsigned short, unsigned short>> runs;
+            for (size_t i = 0; i < a.size();)
+            {
+                size_t j = i;
+                while (j + 1 < a.size() && a[j + 1] == a[j] + 1)
+                    j++;
+                runs.push_back({a[i], (unsigned short)(j - i)});
+                i = j + 1;
+            }
+            size_t runBytes = runs.size() * 4;
+            size_t plainBytes = c.card <= ARRAY_MAX ? c.card * 2 : CHUNK_WORDS * 8;
+            if (runBytes < plainBytes)
+            {
+                c.runs.swap(runs);
+                c.array.clear();
+                c.bits.clear();
+                c.kind = RUN;
+            }
+        }
+    }
+
+    // 并集：逐块合并，两边都是数组时做有序归并，否则按64位字相或
+    RoaringBitmap &operator|=(const RoaringBitmap &other)
+    {
+        for (size_t j = 0; j < other.keys.size(); j++)
+        {
+            const Container &oc = other.containers[j];
+            int idx = findContainer(other.keys[j]);
+            if (idx < 0)
+            {
+                Container &c = getOrCreate(other.keys[j]);
+                c = oc;
+                continue;
+            }
+            Container &c = containers[idx];
+            if (c.kind == ARRAY && oc.kind == ARRAY)
+            {
+                vector<unsigned short> merged;
+                merged.reserve(c.array.size() + oc.array.size());
+                set_union(c.array.begin(), c.array.end(), oc.array.begin(), oc.array.end(), back_inserter(merged));
+                c.array.swap(merged);
+                c.card = c.array.size();
+            }
+            else
+            {
+                vector<unsigned long long> a, b;
+                toWords(c, a);
+                toWords(oc, b);
+                c.card = 0;
+                for (unsigned w = 0; w < CHUNK_WORDS; w++)
+                {
+                    a[w] |= b[w];
+                    c.card += popcount64(a[w]);
+                }
+                c.bits.swap(a);
+                c.array.clear();
+                c.runs.clear();
+                c.kind = BITSET;
+            }
+            normalize(c);
+        }
+        recount();
+        return *this;
+    }
+
+    // 交集：只需处理两边都存在的块，有数组容器时逐个测试数组元素
+    RoaringBitmap &operator&=(const RoaringBitmap &other)
+    {
+        for (int i = (int)keys.size() - 1; i >= 0; i--)
+        {
+            int j = other.findContainer(keys[i]);
+            if (j < 0)
+            {
+                removeContainer(i);
+                continue;
+            }
+            Container &c = containers[i];
+            const Container &oc = other.containers[j];
+            vector<unsigned short> a;
+            if (c.kind == ARRAY || oc.kind == ARRAY)
+            {
+                const Container &arr = c.kind == ARRAY ? c : oc;
+                const Container &rest = c.kind == ARRAY ? oc : c;
+                for (unsigned short v : arr.array)
+                    if (containsLow(rest, v))
+                        a.push_back(v);
+                c.array.swap(a);
+                c.bits.clear();
+                c.runs.clear();
+                c.kind = ARRAY;
+                c.card = c.array.size();
+            }
+            else
+            {
+                vector<unsigned long long> x, y;
+                toWords(c, x);
+                toWords(oc, y);
+                c.card = 0;
+                for (unsigned w = 0; w < CHUNK_WORDS; w++)
+                {
+                    x[w] &= y[w];
+                    c.card += popcount64(x[w]);
+                }
+                c.bits.swap(x);
+                c.runs.clear();
+                c.kind = BITSET;
+            }
+            if (c.card == 0)
+                removeContainer(i);
+            else
+                normalize(c);
+        }
+        recount();
+        return *this;
+    }
+
+    // 实际占用的存储字节数（不含vector自身开销）
+    size_t memoryBytes() const
+    {
+        size_t bytes = keys.size() * 2;
+        for (auto &c : containers)
+            bytes += c.array.size() * 2 + c.bits.size() * 8 + c.runs.size() * 4;
+        return bytes;
+    }
+
+    // 序列化：容器个数，随后每个容器为 键(2) 类型(1) 元素个数(4) 数据
+    void serialize(vector<unsigned char> &out) const
+    {
+        auto put = [&out](unsigned long long v, int bytes)
+        {
+            for (int i = 0; i < bytes; i++)
+                out.push_back((v >> (8 * i)) & 0xff);
+        };
+        put(keys.size(), 4);
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            const Container &c = containers[i];
+            put(keys[i], 2);
+            put(c.kind, 1);
+            if (c.kind == ARRAY)
+            {
+                put(c.array.size(), 4);
+                for (unsigned short v : c.array)
+                    put(v, 2);
+            }
+            else if (c.kind == BITSET)
+            {
+                put(c.card, 4);
+                for (unsigned long long w : c.bits)
+                    put(w, 8);
+            }
+            else
+            {
+                put(c.runs.size(), 4);
+                for (auto &r : c.runs)
+                {
+                    put(r.first, 2);
+                    put(r.second, 2);
+                }
+            }
+        }
+    }
+
+    // 反序列化，数据不完整或不合法时返回false且不修改原内容
+    // 数组须严格递增，游程须有序、互不相邻且不越出块，位图的基数按实际置位重新统计，空容器视为不合法
+    bool deserialize(const unsigned char *p, size_t n)
+    {
+        RoaringBitmap t;
+        size_t pos = 0;
+        bool ok = true;
+        auto get = [&](int bytes)
+        {
+            unsigned long long v = 0;
+            if (pos + bytes > n)
+            {
+                ok = false;
+                return v;
+            }
+            for (int i = 0; i < bytes; i++)
+                v |= (unsigned long long)p[pos + i] << (8 * i);
+            pos += bytes;
+            return v;
+        };
+        size_t cnt = get(4);
+        for (size_t i = 0; i < cnt && ok; i++)
+        {
+            Container c;
+            unsigned short key = get(2);
+            if (!t.keys.empty() && key <= t.keys.back())
+                ok = false; // 键必须严格递增
+            t.keys.push_back(key);
+            unsigned kind = get(1);
+            if (kind > RUN)
+                ok = false;
+            c.kind = (Kind)kind;
+            size_t m = get(4);
+            if (c.kind == ARRAY)
+            {
+                for (size_t k = 0; k < m && ok; k++)
+                {
+                    unsigned short v = get(2);
+                    if (!c.array.empty() && v <= c.array.back())
+                        ok = false;
+                    c.array.push_back(v);
+                }
+                c.card = c.array.size();
+            }
+            else if (c.kind == BITSET)
+            {
+                c.card = 0; // 不信任流中的基数m
+                for (unsigned w = 0; w < CHUNK_WORDS && ok; w++)
+                {
+                    c.bits.push_back(get(8));
+                    c.card += popcount64(c.bits.back());
+                }
+            }
+            else
+            {
+                c.card = 0;
+                for (size_t k = 0; k < m && ok; k++)
+                {
+                    unsigned start = get(2), len = get(2);
+                    if (start + len > 0xffff || (!c.runs.empty() && start <= (unsigned)c.runs.back().first + c.runs.back().second + 1))
+                        ok = false; // 越出块，或与前一个游程重叠、相邻、逆序
+                    c.runs.push_back({(unsigned short)start, (unsigned short)len});
+                    c.card += len + 1;
+                }
+            }
+            if (c.card == 0)
+                ok = false;
+            if (c.kind != RUN)
+                normalize(c); // 游程表示只由runOptimize生成，保留原样
+            t.containers.push_back(c);
+        }
+        if (!ok)
+            return false;
+        t.recount();
+        *this = move(t);
+        return true;
+    }
+
+    string bits2string(size_t n) const
+    {
+        string s;
+        for (size_t i = 0; i < n; i++)
+        {
+            s += test(i) ? '1' : '0';
+        }
+        return s;
+    }
+
+    // 压缩位图无需预先扩展，与bits2string相同
+    string bits2string_and_expand(size_t n)
+    {
+        return bits2string(n);
+    }
+};
+
 // 二叉树节点类
 class BinNode
 {
@@ -113,106 +939,430 @@ public:
     BinNode *left;  // 左子节点
     BinNode *right; // 右子节点
 
-    BinNode(char c = '\0', size_t f = 0, BinNode *l = nullptr, BinNode *r = nullptr)
-        : ch(c), freq(f), left(l), right(r) {}
+    BinNode(char c = '\0', size_t f = 0, BinNode *l = nullptr, BinNode *r = nullptr)
+        : ch(c), freq(f), left(l), right(r) {}
+
+    // 修复3：递归释放子节点，避免内存泄漏
+    ~BinNode()
+    {
+        delete left;
+        delete right;
+    }
+};
+
+// 二叉树类
+class BinTree
+{
+private:
+    BinNode *root;
+
+public:
+    BinTree(BinNode *r = nullptr) : root(r) {}
+    ~BinTree() { delete root; }
+
+    bool isEmpty() const { return root == nullptr; }
+    BinNode *getRoot() const { return root; }
+};
+
+// Huffman树节点类
+class HuffNode : public BinNode
+{
+public:
+    HuffNode(char c = '\0', size_t f = 0, BinNode *l = nullptr, BinNode *r = nullptr)
+        : BinNode(c, f, l, r) {}
+};
+
+// Huffman编码串类型，默认基于Bitmap；BitmapT可替换为接口相同的RoaringBitmap
+template <typename BitmapT = Bitmap>
+class BasicHuffCode
+{
+private:
+    BitmapT bitmap;
+    size_t length;
+
+public:
+    BasicHuffCode(size_t n = 8) : bitmap(n), length(0) {}
+
+    void appendBit(int bit)
+    {
+        if (bit == 1)
+        {
+            bitmap.set(length);
+        }
+        length++;
+    }
+
+    // 追加一个码字：code的低len位，高位先写
+    void appendBits(unsigned long long code, int len)
+    {
+        bitmap.orBits(length, code, len);
+        length += len;
+    }
+
+    string toString() const
+    {
+        return bitmap.bits2string(length);
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+    const BitmapT &bits() const
+    {
+        return bitmap;
+    }
+};
+
+typedef BasicHuffCode<Bitmap> HuffCode;
+
+// 四路交错编码串：第i个字符写入第 i%4 路子流，解码时四路位流可同时推进
+struct HuffCode4
+{
+    HuffCode lane[4];
+    size_t count; // 编码的字符总数
+
+    HuffCode4() : count(0) {}
+};
+
+// 位流读取器：按高位优先顺序读取位图中的比特，每次补充后至少有57位可用
+// BitmapT为Bitmap或RoaringBitmap，通过word(w)按字取数
+template <typename BitmapT>
+class BasicBitReader
+{
+private:
+    const BitmapT *bm;
+    size_t bitPos;             // 位缓冲之后的第一位在码流中的位置
+    unsigned long long bitBuf; // 左对齐的位缓冲
+    int bitCnt;                // 位缓冲中的有效位数
+
+    unsigned long long wordAt(size_t w) const
+    {
+        return bm->word(w); // 越过末尾补0
+    }
+
+public:
+    BasicBitReader(const BasicHuffCode<BitmapT> &code)
+        : bm(&code.bits()), bitPos(0), bitBuf(0), bitCnt(0) {}
+
+    void refill()
+    {
+        if (bitCnt > 56)
+            return;
+        // 从bitPos起取出64位，拼接在现有有效位之后
+        size_t w = bitPos >> 6;
+        int off = bitPos & 63;
+        unsigned long long next = wordAt(w) << off;
+        if (off)
+            next |= wordAt(w + 1) >> (64 - off);
+        bitBuf |= next >> bitCnt;
+        int take = 64 - bitCnt;
+        bitPos += take;
+        bitCnt = 64;
+    }
+
+    // 查看最高的n位（1 <= n <= 57）
+    unsigned peek(int n) const
+    {
+        return (unsigned)(bitBuf >> (64 - n));
+    }
+
+    void consume(int n)
+    {
+        bitBuf <<= n;
+        bitCnt -= n;
+    }
+};
+
+typedef BasicBitReader<Bitmap> BitReader;
 
-    // 修复3：递归释放子节点，避免内存泄漏
-    ~BinNode()
+// 字节直方图：统计256种字节值的出现次数，结果累加到hist中
+// 相邻字节轮流计入多张子直方图，避免同一计数器连续自增造成的存储-加载转发停顿，最后再合并
+void byteHistogram(const unsigned char *p, size_t n, size_t hist[256])
+{
+    const size_t CHUNK = size_t(1) << 30; // 子直方图使用32位计数，分段统计防止溢出
+    const int TABLES = 4;                 // 子直方图张数，下面每字的8个字节按 0..3 两轮计入
+    while (n > 0)
     {
-        delete left;
-        delete right;
+        size_t len = min(n, CHUNK);
+        size_t i = 0;
+        // 每次读取一个64位字，8个字节轮流计入4张子直方图（逐个写出，不用内层循环）
+        unsigned cnt[TABLES][256];
+        memset(cnt, 0, sizeof(cnt));
+        for (; i + 8 <= len; i += 8)
+        {
+            unsigned long long w;
+            memcpy(&w, p + i, 8);
+            cnt[0][w & 0xff]++;
+            cnt[1][(w >> 8) & 0xff]++;
+            cnt[2][(w >> 16) & 0xff]++;
+            cnt[3][(w >> 24) & 0xff]++;
+            cnt[0][(w >> 32) & 0xff]++;
+            cnt[1][(w >> 40) & 0xff]++;
+            cnt[2][(w >> 48) & 0xff]++;
+            cnt[3][w >> 56]++;
+        }
+        for (; i < len; i++)
+            cnt[0][p[i]]++;
+        for (int c = 0; c < 256; c++)
+        {
+            size_t sum = 0;
+            for (int t = 0; t < TABLES; t++)
+                sum += cnt[t][c];
+            hist[c] += sum;
+        }
+        p += len;
+        n -= len;
     }
-};
+}
 
-// 二叉树类
-class BinTree
+// 并行字节直方图：大输入按线程切分，各线程统计局部直方图后合并
+void byteHistogramParallel(const unsigned char *p, size_t n, size_t hist[256], unsigned threads = 0)
 {
-private:
-    BinNode *root;
+    const size_t MIN_PER_THREAD = size_t(1) << 20; // 每个线程至少处理1MB，否则线程开销得不偿失
+    if (threads == 0)
+        threads = max(1u, thread::hardware_concurrency());
+    threads = (unsigned)min<size_t>(threads, max<size_t>(1, n / MIN_PER_THREAD));
+    if (threads <= 1)
+    {
+        byteHistogram(p, n, hist);
+        return;
+    }
 
-public:
-    BinTree(BinNode *r = nullptr) : root(r) {}
-    ~BinTree() { delete root; }
+    vector<vector<size_t>> local(threads, vector<size_t>(256, 0));
+    vector<thread> workers;
+    size_t step = n / threads;
+    for (unsigned t = 0; t < threads; t++)
+    {
+        size_t begin = t * step;
+        size_t len = (t == threads - 1) ? n - begin : step;
+        workers.emplace_back(byteHistogram, p + begin, len, local[t].data());
+    }
+    for (auto &w : workers)
+        w.join();
+    for (unsigned t = 0; t < threads; t++)
+        for (int c = 0; c < 256; c++)
+            hist[c] += local[t][c];
+}
 
-    bool isEmpty() const { return root == nullptr; }
-    BinNode *getRoot() const { return root; }
+// 扁平数组中的Huffman树节点：用下标代替指针，叶节点的left/right为-1
+struct HuffArrayNode
+{
+    size_t freq;
+    int left, right;
+    int symbol; // 叶节点对应的符号下标，内部节点为-1
 };
 
-// Huffman树节点类
-class HuffNode : public BinNode
+// 两队列法线性建树：叶节点按频率排序后放在数组前部，内部节点按创建顺序追加在后部
+// 两段各自频率非降序，每次从两段队首取较小者合并即可，无需堆，也没有逐节点的new/delete
+// 子节点下标总小于父节点，根为最后一个节点；返回根下标，没有符号时返回-1
+int buildHuffArray(const size_t *freq, int n, vector<HuffArrayNode> &nodes)
 {
-public:
-    HuffNode(char c = '\0', size_t f = 0, BinNode *l = nullptr, BinNode *r = nullptr)
-        : BinNode(c, f, l, r) {}
-};
+    nodes.clear();
+    for (int i = 0; i < n; i++)
+    {
+        if (freq[i] > 0)
+            nodes.push_back({freq[i], -1, -1, i});
+    }
+    int m = nodes.size();
+    if (m == 0)
+        return -1;
+    sort(nodes.begin(), nodes.end(), [](const HuffArrayNode &a, const HuffArrayNode &b)
+         { return a.freq < b.freq || (a.freq == b.freq && a.symbol < b.symbol); });
+    nodes.reserve(2 * m - 1);
+
+    int leafHead = 0, nodeHead = m; // 两个队列的队首
+    auto takeMin = [&]()
+    {
+        if (leafHead < m && (nodeHead == (int)nodes.size() || nodes[leafHead].freq <= nodes[nodeHead].freq))
+            return leafHead++;
+        return nodeHead++;
+    };
+    for (int k = 0; k < m - 1; k++)
+    {
+        int a = takeMin();
+        int b = takeMin();
+        nodes.push_back({nodes[a].freq + nodes[b].freq, a, b, -1});
+    }
+    return nodes.size() - 1;
+}
 
 // Huffman编码树
 class HuffTree
 {
 private:
-    BinNode *root;
+    static constexpr int LOOKUP_BITS = 11; // 解码查找表的最大索引位数
+
+    vector<HuffArrayNode> nodes; // 扁平存储的树节点
+    int root;                    // 根节点下标，空树为-1
     map<char, string> encodingMap;
     vector<size_t> freqMap; // 保存26个字母的频率
 
-    void buildEncodingMap(BinNode *node, string code)
+    // 码字的整数形式，按字符下标索引，供位流编码使用
+    unsigned long long codeBits[256];
+    unsigned char codeLen[256];
+    int maxCodeLen;
+
+    // 解码查找表：以位流最高tableBits位为下标，低8位为字符，高8位为码长（码长0表示需沿树解码）
+    int tableBits;
+    vector<unsigned short> decTable;
+
+    // 从根向下按下标递减的顺序为每个节点分配码字（左0右1），生成码字数组和编码表
+    void buildEncodingMap()
     {
-        if (node == nullptr)
+        memset(codeBits, 0, sizeof(codeBits));
+        memset(codeLen, 0, sizeof(codeLen));
+        maxCodeLen = 0;
+        if (root < 0)
             return;
-        if (node->ch != '\0')
+        vector<unsigned long long> bits(nodes.size(), 0);
+        vector<unsigned char> len(nodes.size(), 0);
+        for (int i = root; i >= 0; i--)
         {
-            encodingMap[node->ch] = code;
-            return;
+            const HuffArrayNode &nd = nodes[i];
+            if (nd.left >= 0)
+            {
+                bits[nd.left] = bits[i] << 1;
+                bits[nd.right] = (bits[i] << 1) | 1;
+                len[nd.left] = len[nd.right] = len[i] + 1;
+                continue;
+            }
+            unsigned char c = 'a' + nd.symbol;
+            codeBits[c] = bits[i];
+            codeLen[c] = len[i];
+            maxCodeLen = max(maxCodeLen, (int)len[i]);
+            string code;
+            for (int b = len[i] - 1; b >= 0; b--)
+                code += ((bits[i] >> b) & 1) ? '1' : '0';
+            encodingMap[c] = code;
         }
-        buildEncodingMap(node->left, code + '0');
-        buildEncodingMap(node->right, code + '1');
     }
 
-public:
-    HuffTree(const string &text)
+    // 由码字数组生成解码查找表
+    void buildDecodeTable()
     {
-        // 统计字符频率（只考虑26个字母，不区分大小写）
-        vector<size_t> freq(26, 0);
-        for (char c : text)
+
+        tableBits = min(maxCodeLen, LOOKUP_BITS);
+        decTable.assign(size_t(1) << tableBits, 0);
+        for (auto &kv : encodingMap)
         {
-            if (isalpha(c))
-            {
-                c = tolower(c);
-                freq[c - 'a']++;
-            }
+            unsigned char c = kv.first;
+            int len = codeLen[c];
+            if (len == 0 || len > tableBits)
+                continue;
+            // 以该码字为前缀的所有表项都解码为同一字符
+            size_t first = codeBits[c] << (tableBits - len);
+            size_t cnt = size_t(1) << (tableBits - len);
+            for (size_t j = first; j < first + cnt; j++)
+                decTable[j] = (unsigned short)(c | len << 8);
         }
-        freqMap = freq; // 保存频率
+    }
 
-        // 构建优先队列（最小堆）
-        priority_queue<pair<size_t, BinNode *>,
-                       vector<pair<size_t, BinNode *>>,
-                       greater<pair<size_t, BinNode *>>>
-            pq;
-        for (size_t i = 0; i < 26; i++)
+    // 码长超过查找表位数时，沿Huffman树逐位下行解码；v为左对齐的位串，返回码长
+    int decodeTree(unsigned long long v, char &c) const
+    {
+        int i = root, len = 0;
+        while (nodes[i].left >= 0)
+        {
+            i = ((v >> (63 - len)) & 1) ? nodes[i].right : nodes[i].left;
+            len++;
+        }
+        c = 'a' + nodes[i].symbol;
+        return len;
+    }
+
+    // 解出一个字符并前移pos；v为从pos起的64位（左对齐）
+    char decodeAt(unsigned long long v, size_t &pos) const
+    {
+        unsigned e = decTable[v >> (64 - tableBits)];
+        char c = (char)e;
+        int len = e >> 8;
+        if (len == 0)
+            len = decodeTree(v, c);
+        pos += len;
+        return c;
+    }
+
+    // 码流的连续字数组：Bitmap直接使用底层存储，其他位图按字取出到buf
+    static const unsigned long long *codeWords(const HuffCode &code, vector<unsigned long long> &, size_t &n)
+    {
+        n = code.bits().wordCount();
+        return code.bits().words();
+    }
+
+    template <typename BitmapT>
+    static const unsigned long long *codeWords(const BasicHuffCode<BitmapT> &code, vector<unsigned long long> &buf, size_t &n)
+    {
+        n = (code.size() + 63) / 64;
+        buf.resize(n);
+        for (size_t i = 0; i < n; i++)
+            buf[i] = code.bits().word(i);
+        return buf.data();
+    }
+
+    /* L路交错解码：第i个字符取自第 i%L 路位流，各路只保存当前位置
+       每轮先按最长码长算出各路都不会读过末尾的轮数，这些轮内直接从两个相邻字取64位，
+       不做边界判断也不做“位缓冲是否不足”的判断，L路的取数和查表互不依赖，可以重叠执行 */
+    template <int L>
+    void decodeLanes(const unsigned long long *const *words, const size_t *wordCount, size_t count, char *out) const
+    {
+        const unsigned long long *w[L];
+        size_t n[L], pos[L];
+        for (int k = 0; k < L; k++)
+        {
+            w[k] = words[k];
+            n[k] = wordCount[k];
+            pos[k] = 0;
+        }
+        size_t i = 0;
+        for (;;)
         {
-            if (freq[i] > 0)
+            size_t rounds = (count - i) / L;
+            for (int k = 0; k < L; k++)
             {
-                pq.push({freq[i], new BinNode('a' + i, freq[i])});
+                size_t end = n[k] >= 2 ? (n[k] - 1) * 64 : 0; // pos < end 时 pos/64+1 仍在范围内
+                rounds = min(rounds, pos[k] < end ? (end - pos[k]) / maxCodeLen : 0);
             }
+            if (rounds == 0)
+                break;
+            for (size_t r = 0; r < rounds; r++, i += L)
+                for (int k = 0; k < L; k++)
+                {
+                    size_t p = pos[k], q = p >> 6;
+                    int off = p & 63;
+                    unsigned long long v = (w[k][q] << off) | ((w[k][q + 1] >> 1) >> (63 - off));
+                    out[i + k] = decodeAt(v, pos[k]);
+                }
         }
-
-        // 构建Huffman树
-        while (pq.size() > 1)
+        // 接近末尾的字符逐个取数，越过末尾补0
+        for (; i < count; i++)
         {
-            auto node1 = pq.top();
-            pq.pop();
-            auto node2 = pq.top();
-            pq.pop();
-            BinNode *newNode = new BinNode('\0', node1.first + node2.first, node1.second, node2.second);
-            pq.push({node1.first + node2.first, newNode});
+            int k = i % L;
+            size_t q = pos[k] >> 6;
+            int off = pos[k] & 63;
+            unsigned long long hi = q < n[k] ? w[k][q] : 0, lo = q + 1 < n[k] ? w[k][q + 1] : 0;
+            out[i] = decodeAt((hi << off) | ((lo >> 1) >> (63 - off)), pos[k]);
         }
-
-        root = pq.empty() ? nullptr : pq.top().second;
-        buildEncodingMap(root, "");
     }
 
-    ~HuffTree()
+public:
+    HuffTree(const string &text)
     {
-        delete root; // 会触发BinNode的析构，递归释放所有子节点
+        // 统计字符频率（只考虑26个字母，不区分大小写）：先做全字节直方图，再合并大小写
+        size_t hist[256] = {0};
+        byteHistogramParallel((const unsigned char *)text.data(), text.size(), hist);
+        vector<size_t> freq(26, 0);
+        for (size_t i = 0; i < 26; i++)
+        {
+            freq[i] = hist['a' + i] + hist['A' + i];
+        }
+        freqMap = freq; // 保存频率
+
+        // 两队列法构建Huffman树
+        root = buildHuffArray(freq.data(), 26, nodes);
+        buildEncodingMap();
+        buildDecodeTable();
     }
 
     string getEncoding(char c) const
@@ -261,35 +1411,333 @@ public:
         // 避免除以0
         return totalChars == 0 ? 0 : totalLength / totalChars;
     }
+
+    // 单路位流编码：只编码字母（不区分大小写），返回编码的字符数
+    template <typename BitmapT>
+    size_t encode(const string &text, BasicHuffCode<BitmapT> &out) const
+    {
+        size_t count = 0;
+        for (char c : text)
+        {
+            if (isalpha(c))
+            {
+                unsigned char lc = tolower(c);
+                out.appendBits(codeBits[lc], codeLen[lc]);
+                count++;
+            }
+        }
+        return count;
+    }
+
+    // 四路交错编码：第i个字母写入第 i%4 路子流
+    void encode4(const string &text, HuffCode4 &out) const
+    {
+        out.count = 0;
+        for (char c : text)
+        {
+            if (isalpha(c))
+            {
+                unsigned char lc = tolower(c);
+                out.lane[out.count & 3].appendBits(codeBits[lc], codeLen[lc]);
+                out.count++;
+            }
+        }
+    }
+
+    // 单路解码：从位流中依次解出count个字符
+    template <typename BitmapT>
+    string decode(const BasicHuffCode<BitmapT> &code, size_t count) const
+    {
+        if (root < 0 || count == 0)
+            return "";
+        if (maxCodeLen == 0) // 只有一种字符，码字为空
+            return string(count, 'a' + nodes[root].symbol);
+
+        string out(count, '\0');
+        vector<unsigned long long> buf;
+        size_t n;
+        const unsigned long long *w = codeWords(code, buf, n);
+        decodeLanes<1>(&w, &n, count, &out[0]);
+        return out;
+    }
+
+    // 四路交错解码：同一循环内推进四个位流
+    string decode4(const HuffCode4 &code) const
+    {
+        size_t count = code.count;
+        if (root < 0 || count == 0)
+            return "";
+        if (maxCodeLen == 0)
+            return string(count, 'a' + nodes[root].symbol);
+
+        string out(count, '\0');
+        const unsigned long long *w[4];
+        size_t n[4];
+        for (int k = 0; k < 4; k++)
+        {
+            w[k] = code.lane[k].bits().words();
+            n[k] = code.lane[k].bits().wordCount();
+        }
+        decodeLanes<4>(w, n, count, &out[0]);
+        return out;
+    }
 };
 
-// Huffman编码串类型，基于Bitmap
-class HuffCode
+// 由频率计算Huffman码长（频率为0的符号码长为0）
+void huffCodeLengths(const size_t *freq, int n, unsigned char *len)
+{
+    vector<HuffArrayNode> nodes;
+    memset(len, 0, n);
+    int root = buildHuffArray(freq, n, nodes);
+    if (root < 0)
+        return;
+    if (root == 0) // 只有一种符号时也分配1位码字
+    {
+        len[nodes[0].symbol] = 1;
+        return;
+    }
+
+    // 子节点下标总小于父节点，从根向下递推深度
+    vector<unsigned char> depth(nodes.size(), 0);
+    for (int i = root; i >= 0; i--)
+    {
+        if (nodes[i].left >= 0)
+            depth[nodes[i].left] = depth[nodes[i].right] = depth[i] + 1;
+        else
+            len[nodes[i].symbol] = depth[i];
+    }
+}
+
+// 自适应Huffman模型（字节字母表）：边编码边累计频率，每编码blockSize个字节按最新频率重建一次码表
+// 编码器和解码器按同样的规则更新，因此码表无需随数据传输
+class AdaptiveModel
 {
 private:
-    Bitmap bitmap;
-    size_t length;
+    static constexpr int LOOKUP_BITS = 11;
+    static const size_t MAX_TOTAL = size_t(1) << 16; // 频率总和上限，超过则减半，保证码长不超过BitReader的57位
+
+    size_t freq[256];
+    size_t total;
+    size_t blockSize;
+    size_t sinceRebuild;
+
+    // 范式Huffman码：同一码长的码字连续分配
+    unsigned code[256];
+    unsigned char len[256];
+    int maxLen;
+    unsigned firstCode[64];
+    int firstIndex[64];
+    unsigned lenCount[64];
+    unsigned char sorted[256]; // 按(码长, 字符)排序的字符
+
+    // 解码查找表：(码长<<8)|字符，码长0表示需按码长逐级查找
+    int tableBits;
+    vector<unsigned short> table;
+
+    void halve()
+    {
+        total = 0;
+        for (int c = 0; c < 256; c++)
+        {
+            if (freq[c] > 0)
+                freq[c] = (freq[c] + 1) / 2; // 出现过的字符保持非零
+            total += freq[c];
+        }
+    }
 
 public:
-    HuffCode(size_t n = 8) : bitmap(n), length(0) {}
+    AdaptiveModel(size_t block = 4096) : blockSize(block)
+    {
+        // 初始时所有字节等概率，保证任何字节都可编码
+        for (int c = 0; c < 256; c++)
+            freq[c] = 1;
+        total = 256;
+        rebuild();
+    }
 
-    void appendBit(int bit)
+    // 使用给定频率（静态两遍编码）
+    void setFrequencies(const size_t *f)
     {
-        if (bit == 1)
+        total = 0;
+        for (int c = 0; c < 256; c++)
         {
-            bitmap.set(length);
+            freq[c] = f[c];
+            total += f[c];
         }
-        length++;
+        while (total > MAX_TOTAL)
+            halve();
+        rebuild();
     }
 
-    string toString() const
+    void rebuild()
     {
-        return bitmap.bits2string(length);
+        huffCodeLengths(freq, 256, len);
+        maxLen = 0;
+        memset(lenCount, 0, sizeof(lenCount));
+        for (int c = 0; c < 256; c++)
+        {
+            lenCount[len[c]]++;
+            maxLen = max(maxLen, (int)len[c]);
+        }
+
+        unsigned nextCode = 0;
+        int idx = 0;
+        for (int l = 1; l <= maxLen; l++)
+        {
+            firstCode[l] = nextCode;
+            firstIndex[l] = idx;
+            nextCode = (nextCode + lenCount[l]) << 1;
+            idx += lenCount[l];
+        }
+        int fill[64];
+        memcpy(fill, firstIndex, sizeof(fill));
+        for (int c = 0; c < 256; c++)
+        {
+            int l = len[c];
+            if (l == 0)
+                continue;
+            code[c] = firstCode[l] + (fill[l] - firstIndex[l]);
+            sorted[fill[l]++] = c;
+        }
+
+        tableBits = min(maxLen, LOOKUP_BITS);
+        table.assign(size_t(1) << tableBits, 0);
+        for (int c = 0; c < 256; c++)
+        {
+            int l = len[c];
+            if (l == 0 || l > tableBits)
+                continue;
+            size_t first = (size_t)code[c] << (tableBits - l);
+            size_t cnt = size_t(1) << (tableBits - l);
+            for (size_t j = first; j < first + cnt; j++)
+                table[j] = (unsigned short)((l << 8) | c);
+        }
+        sinceRebuild = 0;
     }
 
-    size_t size() const
+    void update(unsigned char c)
     {
-        return length;
+        freq[c]++;
+        total++;
+        if (total > MAX_TOTAL)
+            halve();
+        if (++sinceRebuild >= blockSize)
+            rebuild();
+    }
+
+    template <typename CodeT>
+    void encode(unsigned char c, CodeT &out) const
+    {
+        out.appendBits(code[c], len[c]);
+    }
+
+    // 调用前需保证br中至少有maxLen位
+    template <typename ReaderT>
+    unsigned char decode(ReaderT &br) const
+    {
+        unsigned short e = table[br.peek(tableBits)];
+        if (e >> 8)
+        {
+            br.consume(e >> 8);
+            return e & 0xff;
+        }
+        unsigned bits = br.peek(maxLen);
+        for (int l = tableBits + 1; l <= maxLen; l++)
+        {
+            unsigned v = (bits >> (maxLen - l)) - firstCode[l];
+            if (v < lenCount[l])
+            {
+                br.consume(l);
+                return sorted[firstIndex[l] + v];
+            }
+        }
+        throw "非法编码";
+    }
+
+    int codeLength(unsigned char c) const
+    {
+        return len[c];
+    }
+};
+
+// 一遍扫描的流式自适应编码器；order1模式下按前一字节的类别选用独立的模型
+class AdaptiveHuffCoder
+{
+private:
+    static const int N_CTX = 7;
+    size_t blockSize;
+    bool order1;
+    vector<AdaptiveModel> models;
+    int ctx; // 当前上下文（前一字节的类别）
+
+public:
+    // 前一字节的类别：换行/控制符、空格、数字、小写、大写、标点、非ASCII
+    static int contextClass(unsigned char c)
+    {
+        if (c >= 0x80)
+            return 6;
+        if (c == ' ')
+            return 1;
+        if (c < 0x20)
+            return 0;
+        if (isdigit(c))
+            return 2;
+        if (islower(c))
+            return 3;
+        if (isupper(c))
+            return 4;
+        return 5;
+    }
+
+    AdaptiveHuffCoder(size_t block = 4096, bool useOrder1 = false)
+        : blockSize(block), order1(useOrder1)
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        models.assign(order1 ? N_CTX : 1, AdaptiveModel(blockSize));
+        ctx = 0;
+    }
+
+    template <typename CodeT>
+    void encodeByte(unsigned char c, CodeT &out)
+    {
+        AdaptiveModel &m = models[ctx];
+        m.encode(c, out);
+        m.update(c);
+        if (order1)
+            ctx = contextClass(c);
+    }
+
+    template <typename ReaderT>
+    unsigned char decodeByte(ReaderT &br)
+    {
+        AdaptiveModel &m = models[ctx];
+        br.refill();
+        unsigned char c = m.decode(br);
+        m.update(c);
+        if (order1)
+            ctx = contextClass(c);
+        return c;
+    }
+
+    template <typename BitmapT>
+    void encode(const string &text, BasicHuffCode<BitmapT> &out)
+    {
+        for (char c : text)
+            encodeByte(c, out);
+    }
+
+    template <typename BitmapT>
+    string decode(const BasicHuffCode<BitmapT> &code, size_t n)
+    {
+        string out(n, '\0');
+        BasicBitReader<BitmapT> br(code);
+        for (size_t i = 0; i < n; i++)
+            out[i] = decodeByte(br);
+        return out;
     }
 };
 
@@ -305,6 +1753,168 @@ I have a dream today!
     return text;
 }
 
+// 线性同余伪随机数（测试数据可复现）
+unsigned rnd32(unsigned &seed)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7fff;
+}
+
+// 生成模拟日志流（用于流式压缩测试）
+string generateLog(size_t bytes)
+{
+    const char *levels[] = {"INFO", "INFO", "INFO", "WARN", "DEBUG", "ERROR"};
+    const char *paths[] = {"/api/login", "/api/orders", "/static/app.js", "/api/users/profile", "/health"};
+    string log;
+    unsigned seed = 2025;
+    auto rnd = [&seed]()
+    {
+        return rnd32(seed);
+    };
+    char line[160];
+    for (unsigned t = 0; log.size() < bytes; t++)
+    {
+        snprintf(line, sizeof(line), "2025-10-%02u %02u:%02u:%02u [%s] worker-%u GET %s status=%u latency=%ums id=%u\n",
+                 1 + t / 86400 % 28, t / 3600 % 24, t / 60 % 60, t % 60, levels[rnd() % 6], rnd() % 8,
+                 paths[rnd() % 5], rnd() % 10 ? 200 : 500, rnd() % 300, rnd());
+        log += line;
+    }
+    return log;
+}
+
+// 位图作为索引结构的测试：rank/select、遍历与批量集合运算
+void testBitmapIndex()
+{
+    const size_t BITS = 10000000;
+    Bitmap bmA, bmB;
+    vector<size_t> onesA;
+    unsigned seed = 7;
+    for (size_t k = 0; k < BITS; k += 1 + rnd32(seed) % 16)
+    {
+        bmA.set(k);
+        onesA.push_back(k);
+    }
+    for (size_t k = 0; k < BITS; k += 1 + rnd32(seed) % 8)
+        bmB.set(k);
+
+    bool bmOk = bmA.size() == onesA.size();
+    auto t0 = chrono::steady_clock::now();
+    for (size_t j = 0; j < onesA.size(); j += 7)
+        bmOk = bmOk && bmA.select(j) == onesA[j] && bmA.rank(onesA[j]) == j;
+    auto t1 = chrono::steady_clock::now();
+    size_t iterCnt = 0;
+    for (size_t k = bmA.nextSet(0); k != Bitmap::npos; k = bmA.nextSet(k + 1))
+        iterCnt++;
+    bmOk = bmOk && iterCnt == onesA.size();
+
+    Bitmap bmAnd = bmA, bmOr = bmA, bmXor = bmA, bmDiff = bmA;
+    auto t2 = chrono::steady_clock::now();
+    bmAnd &= bmB;
+    bmOr |= bmB;
+    bmXor ^= bmB;
+    bmDiff.andNot(bmB);
+    auto t3 = chrono::steady_clock::now();
+    // |A∪B| = |A∩B| + |A⊕B|，|A\B| = |A| - |A∩B|
+    bmOk = bmOk && bmOr.size() == bmAnd.size() + bmXor.size() && bmDiff.size() == bmA.size() - bmAnd.size();
+
+    cout << "\n位图（" << BITS << " 位，" << bmA.size() << " 个置位）" << (bmOk ? "" : "（结果错误）") << ":" << endl;
+    cout << "rank+select: " << chrono::duration<double, nano>(t1 - t0).count() / (onesA.size() / 7 + 1)
+         << " ns/次" << endl;
+    cout << "四种集合运算: " << chrono::duration<double, milli>(t3 - t2).count() << " ms" << endl;
+}
+
+// 压缩位图测试：稀疏、稠密、连续三种分布，与Bitmap对比结果和占用空间
+void testRoaring()
+{
+    Bitmap plain;
+    RoaringBitmap roar, other;
+    unsigned seed = 11;
+    for (int i = 0; i < 2000; i++) // 稀疏：分布在很大范围内
+    {
+        size_t k = (size_t)rnd32(seed) * 1000;
+        plain.set(k);
+        roar.set(k);
+    }
+    for (size_t k = 1 << 20; k < (1 << 20) + 65536; k += 1 + rnd32(seed) % 3) // 稠密
+    {
+        plain.set(k);
+        roar.set(k);
+    }
+    for (size_t k = 3 << 20; k < (3 << 20) + 200000; k++) // 连续
+    {
+        plain.set(k);
+        roar.set(k);
+    }
+    for (size_t k = 0; k < (4 << 20); k += 1 + rnd32(seed) % 64)
+        other.set(k);
+
+    bool ok = roar.size() == plain.size();
+    for (size_t k = plain.nextSet(0); k != Bitmap::npos && ok; k = plain.nextSet(k + 1))
+        ok = roar.test(k);
+    size_t before = roar.memoryBytes();
+    roar.runOptimize();
+    ok = ok && roar.size() == plain.size() && roar.test(3 << 20) && !roar.test((3 << 20) + 200000);
+
+    // 并、交的基数满足 |A∪B| + |A∩B| = |A| + |B|
+    RoaringBitmap uni = roar, inter = roar;
+    uni |= other;
+    inter &= other;
+    ok = ok && uni.size() + inter.size() == roar.size() + other.size();
+
+    vector<unsigned char> bytes;
+    roar.serialize(bytes);
+    RoaringBitmap loaded;
+    ok = ok && loaded.deserialize(bytes.data(), bytes.size()) && loaded.size() == roar.size() && loaded.test(1 << 20) == roar.test(1 << 20);
+
+    // HuffCode可直接换用压缩位图
+    HuffCode hc;
+    BasicHuffCode<RoaringBitmap> rc;
+    for (int i = 0; i < 100; i++)
+    {
+        hc.appendBits(i, 7);
+        rc.appendBits(i, 7);
+    }
+    ok = ok && hc.toString() == rc.toString();
+
+    // 基于压缩位图的码流同样可以解码
+    string text = loadText();
+    HuffTree tree(text);
+    HuffCode pc;
+    BasicHuffCode<RoaringBitmap> tc;
+    size_t letters = tree.encode(text, pc);
+    tree.encode(text, tc);
+    ok = ok && tree.decode(tc, letters) == tree.decode(pc, letters);
+    string log = generateLog(size_t(1) << 16);
+    BasicHuffCode<RoaringBitmap> ac;
+    AdaptiveHuffCoder enc(4096, true), dec(4096, true);
+    enc.encode(log, ac);
+    ok = ok && dec.decode(ac, log.size()) == log;
+
+    // 截断的数据反序列化失败，原内容保持不变
+    RoaringBitmap keep = roar;
+    ok = ok && !keep.deserialize(bytes.data(), bytes.size() / 2) && keep.size() == roar.size() && keep.test(1 << 20) == roar.test(1 << 20);
+
+    // 不合法的数据：游程越出块、游程重叠、数组逆序或重复、空容器，都应被拒绝
+    const vector<vector<unsigned char>> bad = {
+        {1, 0, 0, 0, 0, 0, 2, 1, 0, 0, 0, 0xc0, 0xff, 0xff, 0x00},
+        {1, 0, 0, 0, 0, 0, 2, 2, 0, 0, 0, 10, 0, 5, 0, 12, 0, 1, 0},
+        {1, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 7, 0, 3, 0},
+        {1, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 7, 0, 7, 0},
+        {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}};
+    for (const auto &b : bad)
+        ok = ok && !keep.deserialize(b.data(), b.size()) && keep.size() == roar.size();
+    // 位图容器声明的基数与实际置位不符时按实际置位计数，且转为数组表示
+    vector<unsigned char> bs = {1, 0, 0, 0, 0, 0, 1, 0xff, 0xff, 0, 0};
+    bs.resize(bs.size() + 8192, 0); // 1024个64位字
+    bs[11] = 0x05;
+    RoaringBitmap fixed;
+    ok = ok && fixed.deserialize(bs.data(), bs.size()) && fixed.size() == 2 && fixed.test(0) && fixed.test(2) && !fixed.test(1);
+
+    cout << "\n压缩位图（" << roar.size() << " 个置位）" << (ok ? "" : "（结果错误）") << ":" << endl;
+    cout << "Bitmap: " << plain.capacity() / 8 << " 字节，RoaringBitmap: " << before << " 字节，游程优化后: "
+         << roar.memoryBytes() << " 字节，序列化: " << bytes.size() << " 字节" << endl;
+}
+
 int main()
 {
     // 加载演讲原文
@@ -339,5 +1949,131 @@ int main()
         }
     }
 
+    // 单路与四路交错解码速度对比
+    string bigText;
+    for (int i = 0; i < 4000; i++)
+        bigText += text;
+    string letters;
+    for (char c : bigText)
+        if (isalpha(c))
+            letters += tolower(c);
+
+    HuffCode single;
+    size_t count = huffTree.encode(bigText, single);
+    HuffCode4 multi;
+    huffTree.encode4(bigText, multi);
+
+    const int ROUNDS = 10;
+    string out1, out4;
+    clock_t start = clock();
+    for (int r = 0; r < ROUNDS; r++)
+        out1 = huffTree.decode(single, count);
+    double t1 = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    for (int r = 0; r < ROUNDS; r++)
+        out4 = huffTree.decode4(multi);
+    double t4 = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    double mb = (double)count * ROUNDS / (1024 * 1024);
+    cout << "\n解码测试（" << count << " 个字符，重复" << ROUNDS << "次）:" << endl;
+    cout << "单路解码: " << mb / t1 << " MB/s" << (out1 == letters ? "" : "（结果错误）") << endl;
+    cout << "四路交错解码: " << mb / t4 << " MB/s" << (out4 == letters ? "" : "（结果错误）") << endl;
+    cout << "加速比: " << t1 / t4 << endl;
+
+    // 字节直方图吞吐量：均匀随机数据与高度偏斜数据（90%为同一字节）
+    const size_t HIST_BYTES = size_t(64) << 20;
+    vector<unsigned char> buf(HIST_BYTES);
+    unsigned seed = 12345;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t i = 0; i < HIST_BYTES; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            unsigned char r = seed >> 16;
+            buf[i] = (pass == 1 && r < 230) ? 'e' : r;
+        }
+        size_t h0[256] = {0}, h1[256] = {0}, h2[256] = {0};
+        auto t0 = chrono::steady_clock::now();
+        for (size_t i = 0; i < HIST_BYTES; i++)
+            h0[buf[i]]++;
+        auto ta = chrono::steady_clock::now();
+        byteHistogram(buf.data(), HIST_BYTES, h1);
+        auto tb = chrono::steady_clock::now();
+        byteHistogramParallel(buf.data(), HIST_BYTES, h2);
+        auto tc = chrono::steady_clock::now();
+
+        double gb = (double)HIST_BYTES / (1 << 30);
+        bool ok = equal(h0, h0 + 256, h1) && equal(h0, h0 + 256, h2);
+        cout << "\n字节直方图（" << (pass == 0 ? "均匀数据" : "偏斜数据") << "，64MB）"
+             << (ok ? "" : "（结果不一致）") << ":" << endl;
+        cout << "单表逐字节: " << gb / chrono::duration<double>(ta - t0).count() << " GB/s" << endl;
+        cout << "多子表: " << gb / chrono::duration<double>(tb - ta).count() << " GB/s" << endl;
+        cout << "多线程: " << gb / chrono::duration<double>(tc - tb).count() << " GB/s" << endl;
+    }
+
+    // 流式日志压缩：静态两遍编码 vs 自适应一遍编码（order-0 / order-1）
+    string logText = generateLog(size_t(4) << 20);
+    double logMB = (double)logText.size() / (1024 * 1024);
+    cout << "\n日志流压缩（" << logText.size() << " 字节）:" << endl;
+    for (int mode = 0; mode < 3; mode++)
+    {
+        HuffCode out;
+        string decoded;
+        size_t headerBits = 0;
+        auto t0 = chrono::steady_clock::now();
+        if (mode == 0)
+        {
+            // 第一遍统计频率，第二遍编码；码表（256个码长）需随数据传输
+            size_t hist[256] = {0};
+            byteHistogram((const unsigned char *)logText.data(), logText.size(), hist);
+            AdaptiveModel model;
+            model.setFrequencies(hist);
+            for (char c : logText)
+                model.encode(c, out);
+            headerBits = 256 * 8;
+            auto t1 = chrono::steady_clock::now();
+            decoded.assign(logText.size(), '\0');
+            BitReader br(out);
+            for (size_t i = 0; i < logText.size(); i++)
+            {
+                br.refill();
+                decoded[i] = model.decode(br);
+            }
+            auto t2 = chrono::steady_clock::now();
+            cout << "静态两遍: ";
+            cout << "压缩率 " << (double)(out.size() + headerBits) / (logText.size() * 8) * 100 << "%"
+                 << "，编码 " << logMB / chrono::duration<double>(t1 - t0).count() << " MB/s"
+                 << "，解码 " << logMB / chrono::duration<double>(t2 - t1).count() << " MB/s";
+        }
+        else
+        {
+            AdaptiveHuffCoder enc(4096, mode == 2), dec(4096, mode == 2);
+            enc.encode(logText, out);
+            auto t1 = chrono::steady_clock::now();
+            decoded = dec.decode(out, logText.size());
+            auto t2 = chrono::steady_clock::now();
+            cout << (mode == 1 ? "自适应order-0: " : "自适应order-1: ");
+            cout << "压缩率 " << (double)out.size() / (logText.size() * 8) * 100 << "%"
+                 << "，编码 " << logMB / chrono::duration<double>(t1 - t0).count() << " MB/s"
+                 << "，解码 " << logMB / chrono::duration<double>(t2 - t1).count() << " MB/s";
+        }
+        cout << (decoded == logText ? "" : "（解码错误）") << endl;
+    }
+
+    // 分块重建码表的固定开销
+    AdaptiveModel model;
+    const int REBUILDS = 20000;
+    auto tr0 = chrono::steady_clock::now();
+    for (int r = 0; r < REBUILDS; r++)
+    {
+        model.update(r & 0xff);
+        model.rebuild();
+    }
+    auto tr1 = chrono::steady_clock::now();
+    cout << "码表重建（256个符号）: " << chrono::duration<double, micro>(tr1 - tr0).count() / REBUILDS << " us/次" << endl;
+
+    testBitmapIndex();
+    testRoaring();
+
     return 0;
 }
\ No newline at end of file
@@ -5,6 +5,12 @@
 #include <ctime>
 #include <algorithm>
 #include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
@@ -27,6 +33,8 @@ public:
 
     double modulus() const { return sqrt(real * real + imag * imag); }
 
+    double norm() const { return real * real + imag * imag; }
+
     bool operator==(const Complex &other) const
     {
         return (real == other.real) && (imag == other.imag);
@@ -84,6 +92,101 @@ size_t findComplex(const vector<Complex> &vec, const Complex &target)
     return -1;
 }
 
+// 与operator==一致：+0.0与-0.0相等，统一取+0.0的位模式
+inline uint64_t equalBits(double d)
+{
+    if (d == 0)
+        d = 0;
+    uint64_t u;
+    memcpy(&u, &d, sizeof(u));
+    return u;
+}
+
+inline uint64_t hashComplex(const Complex &c)
+{
+    uint64_t h = equalBits(c.getReal()) * 0x9e3779b97f4a7c15ULL ^ equalBits(c.getImag());
+    h ^= h >> 32;
+    h *= 0xd6e8feb86659fd93ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+// 向量上的哈希索引（开放定址，线性探测），find返回第一个相等元素的位置，找不到返回-1
+// 只记录位置，向量末尾追加的元素在下次查找时补进索引；在中间插入或删除后需调用rebuild
+class ComplexIndex
+{
+public:
+    explicit ComplexIndex(const vector<Complex> &v) : vec(&v), indexed(0), used(0), slots(16, EMPTY) {}
+
+    size_t find(const Complex &c)
+    {
+        sync();
+        size_t mask = slots.size() - 1;
+        for (size_t s = hashComplex(c) & mask; slots[s] != EMPTY; s = (s + 1) & mask)
+            if ((*vec)[slots[s]] == c)
+                return slots[s];
+        return -1;
+    }
+
+    void rebuild()
+    {
+        fill(slots.begin(), slots.end(), EMPTY);
+        indexed = used = 0;
+        sync();
+    }
+
+private:
+    static constexpr size_t EMPTY = (size_t)-1;
+    const vector<Complex> *vec;
+    size_t indexed;
+    size_t used;
+    vector<size_t> slots;
+
+    void sync()
+    {
+        size_t need = (used + vec->size() - indexed) * 2;
+        if (need > slots.size())
+        {
+            size_t cap = slots.size();
+            while (cap < need)
+                cap <<= 1;
+            rehash(cap);
+        }
+        for (; indexed < vec->size(); ++indexed)
+            insert(indexed);
+    }
+
+    // 已有相等元素时保留先出现的位置；含NaN的元素与任何元素都不相等，不必记录
+    void insert(size_t pos)
+    {
+        const Complex &c = (*vec)[pos];
+        if (!(c == c))
+            return;
+        size_t mask = slots.size() - 1;
+        size_t s = hashComplex(c) & mask;
+        for (; slots[s] != EMPTY; s = (s + 1) & mask)
+            if ((*vec)[slots[s]] == c)
+                return;
+        slots[s] = pos;
+        used++;
+    }
+
+    void rehash(size_t cap)
+    {
+        vector<size_t> old(cap, EMPTY);
+        old.swap(slots);
+        size_t mask = slots.size() - 1;
+        for (size_t pos : old)
+            if (pos != EMPTY)
+            {
+                size_t s = hashComplex((*vec)[pos]) & mask;
+                while (slots[s] != EMPTY)
+                    s = (s + 1) & mask;
+                slots[s] = pos;
+            }
+    }
+};
+
 void insertComplex(vector<Complex> &vec, size_t pos, const Complex &c)
 {
     if (pos <= vec.size())
@@ -103,9 +206,10 @@ void deleteComplex(vector<Complex> &vec, size_t pos)
 void uniqueVector(vector<Complex> &vec)
 {
     vector<Complex> temp;
+    ComplexIndex index(temp);
     for (const auto &c : vec)
     {
-        if (findComplex(temp, c) == -1)
+        if (index.find(c) == (size_t)-1)
         {
             temp.push_back(c);
         }
@@ -171,6 +275,74 @@ void mergeSort(vector<Complex> &vec, int left, int right)
     }
 }
 
+// 把double映射为无符号整数，整数大小顺序与double大小顺序一致
+inline uint64_t orderedBits(double d)
+{
+    uint64_t u;
+    memcpy(&u, &d, sizeof(u));
+    return (u >> 63) ? ~u : u | (1ULL << 63);
+}
+
+struct SortKey
+{
+    uint64_t key;
+    uint32_t index;
+};
+
+// 与mergeSort相同的顺序（按模，模相同时按实部，再相同时保持原顺序），但每个元素只算一次模的平方作为键：
+// 对键和下标做基数排序（每趟11位，所有元素该位都相同的趟跳过），最后一次性搬动元素
+// 不同的模平方开方后可能相等，而mergeSort比较的是开方后的模，所以排好后按模（每个元素开方一次）分段，段内再按实部排
+void radixSort(vector<Complex> &vec)
+{
+    const int BITS = 11, PASSES = 6, RADIX = 1 << BITS;
+    size_t n = vec.size();
+    vector<SortKey> a(n), b(n);
+    vector<size_t> count((size_t)PASSES * RADIX, 0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        a[i].key = orderedBits(vec[i].norm());
+        a[i].index = (uint32_t)i;
+        for (int p = 0; p < PASSES; ++p)
+            count[p * RADIX + ((a[i].key >> (p * BITS)) & (RADIX - 1))]++;
+    }
+    for (int p = 0; p < PASSES; ++p)
+    {
+        size_t *c = &count[p * RADIX];
+        if (n == 0 || c[(a[0].key >> (p * BITS)) & (RADIX - 1)] == n)
+            continue;
+        size_t sum = 0;
+        for (int d = 0; d < RADIX; ++d)
+        {
+            size_t t = c[d];
+            c[d] = sum;
+            sum += t;
+        }
+        for (size_t i = 0; i < n; ++i)
+            b[c[(a[i].key >> (p * BITS)) & (RADIX - 1)]++] = a[i];
+        a.swap(b);
+    }
+
+    vector<double> mod(n);
+    for (size_t i = 0; i < n; ++i)
+        mod[i] = vec[a[i].index].modulus();
+    for (size_t i = 0; i < n;)
+    {
+        size_t j = i + 1;
+        while (j < n && mod[j] == mod[i])
+            j++;
+        if (j - i > 1)
+            sort(a.begin() + i, a.begin() + j, [&vec](const SortKey &x, const SortKey &y)
+                 { return vec[x.index].getReal() < vec[y.index].getReal() ||
+                          (vec[x.index].getReal() == vec[y.index].getReal() && x.index < y.index); });
+        i = j;
+    }
+
+    vector<Complex> sorted(n);
+    for (size_t i = 0; i < n; ++i)
+        sorted[i] = vec[a[i].index];
+    vec.swap(sorted);
+}
+
 vector<Complex> rangeSearch(const vector<Complex> &vec, double m1, double m2)
 {
     vector<Complex> result;
@@ -185,6 +357,404 @@ vector<Complex> rangeSearch(const vector<Complex> &vec, double m1, double m2)
     return result;
 }
 
+// 按模排好序的元素（模的平方与值放在一起），区间查询为两次二分加一段连续复制，结果按模从小到大
+// 插入先放进一个小的有序缓冲区，删除在主数组上打标记，缓冲区或标记过多时合并重建
+class ModulusIndex
+{
+public:
+    explicit ModulusIndex(const vector<Complex> &vec) : deadCount(0)
+    {
+        base.reserve(vec.size());
+        for (const auto &c : vec)
+            base.push_back(Entry{c.norm(), c});
+        sort(base.begin(), base.end(), less);
+        dead.assign(base.size(), 0);
+    }
+
+    size_t size() const { return base.size() - deadCount + added.size(); }
+
+    // 与rangeSearch相同的条件：m1 <= 模 < m2
+    vector<Complex> rangeSearch(double m1, double m2) const
+    {
+        vector<Complex> result;
+        append(m1, m2, result);
+        return result;
+    }
+
+    // 第i个区间的结果为 out[offsets[i], offsets[i+1])
+    void rangeSearchBatch(const vector<pair<double, double>> &ranges, vector<Complex> &out, vector<size_t> &offsets) const
+    {
+        out.clear();
+        offsets.assign(1, 0);
+        for (const auto &r : ranges)
+        {
+            append(r.first, r.second, out);
+            offsets.push_back(out.size());
+        }
+    }
+
+    void insert(const Complex &c)
+    {
+        Entry e{c.norm(), c};
+        added.insert(upper_bound(added.begin(), added.end(), e, less), e);
+        if (added.size() > max((size_t)256, (size_t)sqrt((double)base.size())))
+            compact();
+    }
+
+    // 删除一个与c相等的元素，没有则返回false
+    bool erase(const Complex &c)
+    {
+        Entry e{c.norm(), c};
+        auto range = equal_range(added.begin(), added.end(), e, less);
+        for (auto it = range.first; it != range.second; ++it)
+            if (it->value == c)
+            {
+                added.erase(it);
+                return true;
+            }
+        range = equal_range(base.begin(), base.end(), e, less);
+        for (auto it = range.first; it != range.second; ++it)
+            if (it->value == c && !dead[it - base.begin()])
+            {
+                dead[it - base.begin()] = 1;
+                if (++deadCount > base.size() / 8)
+                    compact();
+                return true;
+            }
+        return false;
+    }
+
+private:
+    struct Entry
+    {
+        double norm;
+        Complex value;
+    };
+
+    vector<Entry> base;
+    vector<char> dead;
+    size_t deadCount;
+    vector<Entry> added;
+
+    static bool less(const Entry &a, const Entry &b)
+    {
+        return a.norm < b.norm || (a.norm == b.norm && a.value.getReal() < b.value.getReal());
+    }
+
+    // 模关于模的平方单调，直接对sqrt(norm)二分，与逐个比较模的结果完全一致
+    static pair<size_t, size_t> bounds(const vector<Entry> &v, double m1, double m2)
+    {
+        auto lo = partition_point(v.begin(), v.end(), [m1](const Entry &e)
+                                  { return sqrt(e.norm) < m1; });
+        auto hi = partition_point(lo, v.end(), [m2](const Entry &e)
+                                  { return sqrt(e.norm) < m2; });
+        return make_pair(lo - v.begin(), hi - v.begin());
+    }
+
+    void append(double m1, double m2, vector<Complex> &out) const
+    {
+        pair<size_t, size_t> b = bounds(base, m1, m2), a = bounds(added, m1, m2);
+        size_t i = b.first, j = a.first;
+        while (i < b.second || j < a.second)
+        {
+            if (i < b.second && dead[i])
+                i++;
+            else if (j == a.second || (i < b.second && !less(added[j], base[i])))
+                out.push_back(base[i++].value);
+            else
+                out.push_back(added[j++].value);
+        }
+    }
+
+    void compact()
+    {
+        vector<Entry> merged;
+        merged.reserve(size());
+        size_t j = 0;
+        for (size_t i = 0; i < base.size(); ++i)
+        {
+            if (dead[i])
+                continue;
+            while (j < added.size() && less(added[j], base[i]))
+                merged.push_back(added[j++]);
+            merged.push_back(base[i]);
+        }
+        merged.insert(merged.end(), added.begin() + j, added.end());
+        base.swap(merged);
+        dead.assign(base.size(), 0);
+        deadCount = 0;
+        added.clear();
+    }
+};
+
+template <class T>
+struct AlignedAllocator
+{
+    typedef T value_type;
+
+    AlignedAllocator() = default;
+
+    template <class U>
+    AlignedAllocator(const AlignedAllocator<U> &) {}
+
+    T *allocate(size_t n) { return (T *)::operator new(n * sizeof(T), align_val_t(32)); }
+
+    void deallocate(T *p, size_t) { ::operator delete(p, align_val_t(32)); }
+
+    template <class U>
+    bool operator==(const AlignedAllocator<U> &) const { return true; }
+
+    template <class U>
+    bool operator!=(const AlignedAllocator<U> &) const { return false; }
+};
+
+// 实部、虚部分别连续存放（32字节对齐），各运算在AVX2下每次处理4个元素，否则逐个计算
+// 向量化路径需要 -mavx2 编译（-march=native 时另有FMA），默认编译只走标量循环
+class ComplexVector
+{
+public:
+    ComplexVector() {}
+
+    explicit ComplexVector(const vector<Complex> &vec) : re(vec.size()), im(vec.size())
+    {
+        for (size_t i = 0; i < vec.size(); ++i)
+        {
+            re[i] = vec[i].getReal();
+            im[i] = vec[i].getImag();
+        }
+    }
+
+    vector<Complex> toVector() const
+    {
+        vector<Complex> vec(size());
+        for (size_t i = 0; i < size(); ++i)
+            vec[i] = Complex(re[i], im[i]);
+        return vec;
+    }
+
+    size_t size() const { return re.size(); }
+
+    Complex operator[](size_t i) const { return Complex(re[i], im[i]); }
+
+    void push_back(const Complex &c)
+    {
+        re.push_back(c.getReal());
+        im.push_back(c.getImag());
+    }
+
+    const double *realData() const { return re.data(); }
+
+    const double *imagData() const { return im.data(); }
+
+    // 模的平方
+    void norms(double *out) const
+    {
+        size_t i = 0, n = size();
+#ifdef __AVX2__
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(out + i, norm4(i));
+#endif
+        for (; i < n; ++i)
+            out[i] = re[i] * re[i] + im[i] * im[i];
+    }
+
+    void moduli(double *out) const
+    {
+        size_t i = 0, n = size();
+#ifdef __AVX2__
+        for (; i + 4 <= n; i += 4)
+            _mm256_storeu_pd(out + i, _mm256_sqrt_pd(norm4(i)));
+#endif
+        for (; i < n; ++i)
+            out[i] = sqrt(re[i] * re[i] + im[i] * im[i]);
+    }
+
+    // 模在[m1, m2)内的元素，保持原顺序；模的算式及其FMA收缩方式与Complex::modulus相同，结果与rangeSearch一致
+    // 每块先压紧到栈上的小缓冲区再整块追加，AVX2下按比较掩码查表重排4个元素
+    ComplexVector rangeFilter(double m1, double m2) const
+    {
+        const size_t BLOCK = 4096;
+        alignas(32) double bre[BLOCK + 4], bim[BLOCK + 4];
+        ComplexVector result;
+        size_t n = size(); // 结果按块追加，容量随实际保留的元素成倍增长，不按输入大小预留
+        for (size_t start = 0; start < n; start += BLOCK)
+        {
+            size_t end = min(n, start + BLOCK), k = 0, i = start;
+#ifdef __AVX2__
+            const __m256d lo = _mm256_set1_pd(m1), hi = _mm256_set1_pd(m2);
+            for (; i + 4 <= end; i += 4)
+            {
+                __m256d mod = _mm256_sqrt_pd(norm4(i));
+                int mask = _mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(mod, lo, _CMP_GE_OQ), _mm256_cmp_pd(mod, hi, _CMP_LT_OQ)));
+                __m256i perm = _mm256_load_si256((const __m256i *)COMPRESS[mask]);
+                _mm256_storeu_pd(bre + k, _mm256_castps_pd(_mm256_permutevar8x32_ps(_mm256_castpd_ps(_mm256_load_pd(&re[i])), perm)));
+                _mm256_storeu_pd(bim + k, _mm256_castps_pd(_mm256_permutevar8x32_ps(_mm256_castpd_ps(_mm256_load_pd(&im[i])), perm)));
+                k += __builtin_popcount(mask);
+            }
+#endif
+            for (; i < end; ++i)
+            {
+                double mod = sqrt(re[i] * re[i] + im[i] * im[i]);
+                if (mod >= m1 && mod < m2)
+                {
+                    bre[k] = re[i];
+                    bim[k++] = im[i];
+                }
+            }
+            result.re.insert(result.re.end(), bre, bre + k);
+            result.im.insert(result.im.end(), bim, bim + k);
+        }
+        return result;
+    }
+
+    // 第一个与c相等的元素的位置（判等与Complex::operator==相同），找不到返回-1
+    size_t find(const Complex &c) const
+    {
+        size_t i = 0, n = size();
+#ifdef __AVX2__
+        const __m256d r = _mm256_set1_pd(c.getReal()), m = _mm256_set1_pd(c.getImag());
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256d eq = _mm256_and_pd(_mm256_cmp_pd(_mm256_load_pd(&re[i]), r, _CMP_EQ_OQ),
+                                       _mm256_cmp_pd(_mm256_load_pd(&im[i]), m, _CMP_EQ_OQ));
+            int mask = _mm256_movemask_pd(eq);
+            if (mask != 0)
+                return i + __builtin_ctz(mask);
+        }
+#endif
+        for (; i < n; ++i)
+            if (re[i] == c.getReal() && im[i] == c.getImag())
+                return i;
+        return -1;
+    }
+
+    // 逐元素运算，两个向量长度须相同
+    ComplexVector operator+(const ComplexVector &o) const
+    {
+        ComplexVector r(size());
+        size_t i = 0, n = size();
+#ifdef __AVX2__
+        for (; i + 4 <= n; i += 4)
+        {
+            _mm256_store_pd(&r.re[i], _mm256_add_pd(_mm256_load_pd(&re[i]), _mm256_load_pd(&o.re[i])));
+            _mm256_store_pd(&r.im[i], _mm256_add_pd(_mm256_load_pd(&im[i]), _mm256_load_pd(&o.im[i])));
+        }
+#endif
+        for (; i < n; ++i)
+        {
+            r.re[i] = re[i] + o.re[i];
+            r.im[i] = im[i] + o.im[i];
+        }
+        return r;
+    }
+
+    ComplexVector operator-(const ComplexVector &o) const
+    {
+        ComplexVector r(size());
+        size_t i = 0, n = size();
+#ifdef __AVX2__
+        for (; i + 4 <= n; i += 4)
+        {
+            _mm256_store_pd(&r.re[i], _mm256_sub_pd(_mm256_load_pd(&re[i]), _mm256_load_pd(&o.re[i])));
+            _mm256_store_pd(&r.im[i], _mm256_sub_pd(_mm256_load_pd(&im[i]), _mm256_load_pd(&o.im[i])));
+        }
+#endif
+        for (; i < n; ++i)
+        {
+            r.re[i] = re[i] - o.re[i];
+            r.im[i] = im[i] - o.im[i];
+        }
+        return r;
+    }
+
+    ComplexVector operator*(const ComplexVector &o) const
+    {
+        ComplexVector r(size());
+        size_t i = 0, n = size();
+#ifdef __AVX2__
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256d a = _mm256_load_pd(&re[i]), b = _mm256_load_pd(&im[i]);
+            __m256d c = _mm256_load_pd(&o.re[i]), d = _mm256_load_pd(&o.im[i]);
+            _mm256_store_pd(&r.re[i], mulSub(a, c, _mm256_mul_pd(b, d)));
+            _mm256_store_pd(&r.im[i], mulAdd(a, d, _mm256_mul_pd(b, c)));
+        }
+#endif
+        for (; i < n; ++i)
+        {
+            r.re[i] = re[i] * o.re[i] - im[i] * o.im[i];
+            r.im[i] = re[i] * o.im[i] + im[i] * o.re[i];
+        }
+        return r;
+    }
+
+    ComplexVector operator/(const ComplexVector &o) const
+    {
+        ComplexVector r(size());
+        size_t i = 0, n = size();
+#ifdef __AVX2__
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256d a = _mm256_load_pd(&re[i]), b = _mm256_load_pd(&im[i]);
+            __m256d c = _mm256_load_pd(&o.re[i]), d = _mm256_load_pd(&o.im[i]);
+            __m256d den = mulAdd(c, c, _mm256_mul_pd(d, d));
+            _mm256_store_pd(&r.re[i], _mm256_div_pd(mulAdd(a, c, _mm256_mul_pd(b, d)), den));
+            _mm256_store_pd(&r.im[i], _mm256_div_pd(mulSub(b, c, _mm256_mul_pd(a, d)), den));
+        }
+#endif
+        for (; i < n; ++i)
+        {
+            double den = o.re[i] * o.re[i] + o.im[i] * o.im[i];
+            r.re[i] = (re[i] * o.re[i] + im[i] * o.im[i]) / den;
+            r.im[i] = (im[i] * o.re[i] - re[i] * o.im[i]) / den;
+        }
+        return r;
+    }
+
+private:
+    vector<double, AlignedAllocator<double>> re, im;
+
+    explicit ComplexVector(size_t n) : re(n), im(n) {}
+
+#ifdef __AVX2__
+    // 掩码的第j位为1表示第j个元素保留；表项把保留的元素（每个占两个32位通道）依次移到低位
+    alignas(32) static const int COMPRESS[16][8];
+
+    // a*b + c 与 a*b - c：有FMA时编译器把标量式 x*y ± z*w 收缩为 fma(x, y, ±z*w)，这里按同样方式计算，与标量结果逐位相同
+    static __m256d mulAdd(__m256d a, __m256d b, __m256d c)
+    {
+#ifdef __FMA__
+        return _mm256_fmadd_pd(a, b, c);
+#else
+        return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+#endif
+    }
+
+    static __m256d mulSub(__m256d a, __m256d b, __m256d c)
+    {
+#ifdef __FMA__
+        return _mm256_fmsub_pd(a, b, c);
+#else
+        return _mm256_sub_pd(_mm256_mul_pd(a, b), c);
+#endif
+    }
+
+    __m256d norm4(size_t i) const
+    {
+        __m256d a = _mm256_load_pd(&re[i]), b = _mm256_load_pd(&im[i]);
+        return mulAdd(a, a, _mm256_mul_pd(b, b));
+    }
+#endif
+};
+
+#ifdef __AVX2__
+alignas(32) const int ComplexVector::COMPRESS[16][8] = {
+    {0, 1, 0, 1, 0, 1, 0, 1}, {0, 1, 0, 1, 0, 1, 0, 1}, {2, 3, 0, 1, 0, 1, 0, 1}, {0, 1, 2, 3, 0, 1, 0, 1},
+    {4, 5, 0, 1, 0, 1, 0, 1}, {0, 1, 4, 5, 0, 1, 0, 1}, {2, 3, 4, 5, 0, 1, 0, 1}, {0, 1, 2, 3, 4, 5, 0, 1},
+    {6, 7, 0, 1, 0, 1, 0, 1}, {0, 1, 6, 7, 0, 1, 0, 1}, {2, 3, 6, 7, 0, 1, 0, 1}, {0, 1, 2, 3, 6, 7, 0, 1},
+    {4, 5, 6, 7, 0, 1, 0, 1}, {0, 1, 4, 5, 6, 7, 0, 1}, {2, 3, 4, 5, 6, 7, 0, 1}, {0, 1, 2, 3, 4, 5, 6, 7}};
+#endif
+
 void printVector(const vector<Complex> &vec, const string &msg = "")
 {
     if (!msg.empty())
@@ -197,6 +767,180 @@ void printVector(const vector<Complex> &vec, const string &msg = "")
          << endl;
 }
 
+void testLargeSort()
+{
+    int n = 10000000;
+    vector<Complex> vec = generateRandomComplexVector(n, -100, 100);
+    vector<Complex> a = vec, b = vec;
+    clock_t start = clock();
+    mergeSort(a, 0, a.size() - 1);
+    double t1 = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    radixSort(b);
+    double t2 = (double)(clock() - start) / CLOCKS_PER_SEC;
+    cout << n << " 个元素：归并排序耗时 " << t1 << "秒，基数排序耗时 " << t2 << "秒"
+         << (a == b ? "" : "（结果不一致）") << endl;
+
+    // 单位圆上的点：模的平方各不相同，开方后却大量相等，按模相同再按实部排
+    vector<Complex> circle;
+    for (int i = 0; i < 200000; ++i)
+        circle.push_back(Complex(cos(i * 1e-4), sin(i * 1e-4)));
+    shuffleVector(circle);
+    a = circle;
+    b = circle;
+    mergeSort(a, 0, a.size() - 1);
+    radixSort(b);
+    cout << "单位圆上 " << circle.size() << " 个点：基数排序" << (a == b ? "与归并排序一致" : "与归并排序结果不一致") << endl
+         << endl;
+}
+
+void testUnique()
+{
+    vector<Complex> small = generateRandomComplexVector(3000, -5, 5);
+    for (int i = 0; i < 2000; ++i)
+        small.push_back(small[rand() % small.size()]);
+    small.push_back(Complex(0.0, 1));
+    small.push_back(Complex(-0.0, 1));
+    small.push_back(Complex(NAN, 0));
+    small.push_back(Complex(NAN, 0));
+    shuffleVector(small);
+    vector<Complex> expect;
+    for (const auto &c : small)
+        if (findComplex(expect, c) == (size_t)-1)
+            expect.push_back(c);
+    vector<Complex> got = small;
+    uniqueVector(got);
+    bool ok = got.size() == expect.size();
+    for (size_t i = 0; ok && i < got.size(); ++i)
+        ok = got[i] == expect[i] || (got[i] != got[i] && expect[i] != expect[i]);
+    cout << "唯一化正确性：" << (ok ? "与逐个查找一致" : "结果不一致") << endl;
+
+    int n = 10000000;
+    vector<Complex> vec = generateRandomComplexVector(n / 2, -100, 100);
+    for (int i = n / 2; i < n; ++i)
+        vec.push_back(vec[rand() % (n / 2)]);
+    shuffleVector(vec);
+    clock_t start = clock();
+    uniqueVector(vec);
+    double t1 = (double)(clock() - start) / CLOCKS_PER_SEC;
+    cout << n << " 个元素唯一化耗时 " << t1 << "秒，剩余 " << vec.size() << " 个" << endl;
+
+    start = clock();
+    ComplexIndex index(vec);
+    index.rebuild();
+    double tBuild = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    size_t hits = 0;
+    for (int i = 0; i < 1000000; ++i)
+        hits += index.find(vec[rand() % vec.size()]) != (size_t)-1;
+    vec.push_back(Complex(1000, 1000));
+    size_t appended = index.find(Complex(1000, 1000));
+    double t2 = (double)(clock() - start) / CLOCKS_PER_SEC;
+    cout << "建立索引耗时 " << tBuild << "秒，索引查找 1000000 次耗时 " << t2 << "秒，命中 " << hits << " 次，追加元素的位置 " << appended << endl
+         << endl;
+}
+
+void testRangeIndex()
+{
+    auto byKey = [](const Complex &a, const Complex &b)
+    {
+        return a.norm() < b.norm() || (a.norm() == b.norm() && (a.getReal() < b.getReal() ||
+                                                                (a.getReal() == b.getReal() && a.getImag() < b.getImag())));
+    };
+    int n = 1000000;
+    vector<Complex> vec = generateRandomComplexVector(n, -100, 100);
+    ModulusIndex index(vec);
+
+    // 随机插入删除后与直接扫描比较
+    for (int i = 0; i < 20000; ++i)
+    {
+        if (rand() % 2)
+        {
+            Complex c = generateRandomComplexVector(1, -100, 100)[0];
+            vec.push_back(c);
+            index.insert(c);
+        }
+        else
+        {
+            size_t k = rand() % vec.size();
+            index.erase(vec[k]);
+            vec[k] = vec.back();
+            vec.pop_back();
+        }
+    }
+    bool ok = index.size() == vec.size();
+    for (int q = 0; q < 50 && ok; ++q)
+    {
+        double m1 = rand() % 150, m2 = m1 + rand() % 20;
+        vector<Complex> a = rangeSearch(vec, m1, m2), b = index.rangeSearch(m1, m2);
+        sort(a.begin(), a.end(), byKey);
+        sort(b.begin(), b.end(), byKey);
+        ok = a == b;
+    }
+    cout << "模索引正确性（插入删除后）：" << (ok ? "与逐个扫描一致" : "结果不一致") << endl;
+
+    const int Q = 1000;
+    vector<pair<double, double>> ranges(Q);
+    for (auto &r : ranges)
+    {
+        r.first = rand() % 140;
+        r.second = r.first + 1;
+    }
+    clock_t start = clock();
+    size_t total = 0;
+    for (const auto &r : ranges)
+        total += rangeSearch(vec, r.first, r.second).size();
+    double t1 = (double)(clock() - start) / CLOCKS_PER_SEC;
+    vector<Complex> out;
+    vector<size_t> offsets;
+    start = clock();
+    index.rangeSearchBatch(ranges, out, offsets);
+    double t2 = (double)(clock() - start) / CLOCKS_PER_SEC;
+    cout << Q << " 次圆环查询：逐个扫描耗时 " << t1 << "秒，模索引耗时 " << t2 << "秒"
+         << (out.size() == total ? "" : "（结果个数不一致）") << endl
+         << endl;
+}
+
+void testComplexVector()
+{
+    vector<Complex> small = generateRandomComplexVector(1003, -10, 10);
+    ComplexVector cv(small), cv2(generateRandomComplexVector(1003, -10, 10));
+    vector<double> norms(cv.size()), mods(cv.size());
+    cv.norms(norms.data());
+    cv.moduli(mods.data());
+    bool ok = cv.toVector() == small;
+    for (size_t i = 0; i < small.size(); ++i)
+        ok = ok && norms[i] == small[i].norm() && mods[i] == small[i].modulus();
+    ok = ok && cv.rangeFilter(3, 7).toVector() == rangeSearch(small, 3, 7);
+    ok = ok && cv.find(small[777]) == findComplex(small, small[777]) && cv.find(Complex(100, 100)) == (size_t)-1;
+    ComplexVector prod = cv * cv2, quot = prod / cv2, sum = cv + cv2, diff = sum - cv2;
+    for (size_t i = 0; i < small.size(); ++i)
+    {
+        double a = cv[i].getReal(), b = cv[i].getImag(), c = cv2[i].getReal(), d = cv2[i].getImag();
+        ok = ok && prod[i] == Complex(a * c - b * d, a * d + b * c) && sum[i] == Complex(a + c, b + d);
+        ok = ok && fabs(quot[i].getReal() - a) < 1e-9 && fabs(quot[i].getImag() - b) < 1e-9 &&
+             fabs(diff[i].getReal() - a) < 1e-9 && fabs(diff[i].getImag() - b) < 1e-9;
+    }
+    cout << "ComplexVector正确性：" << (ok ? "与逐个计算一致" : "结果不一致") << endl;
+
+    int n = 50000000;
+    vector<Complex> vec = generateRandomComplexVector(n, -100, 100);
+    clock_t start = clock();
+    size_t k1 = rangeSearch(vec, 40, 60).size();
+    double t1 = (double)(clock() - start) / CLOCKS_PER_SEC;
+    ComplexVector big(vec);
+    vector<Complex>().swap(vec);
+    start = clock();
+    size_t k2 = big.rangeFilter(40, 60).size();
+    double t2 = (double)(clock() - start) / CLOCKS_PER_SEC;
+    cout << n << " 个元素按模筛选：rangeSearch耗时 " << t1 << "秒，ComplexVector耗时 " << t2 << "秒（"
+         << n * 16.0 / t2 / 1e9 << " GB/s）" << (k1 == k2 ? "" : "（结果个数不一致）") << endl;
+#ifndef __AVX2__
+    cout << "（未启用AVX2，ComplexVector走标量循环，受计算而非内存带宽限制；测向量化吞吐请用 -mavx2 或 -march=native 编译）" << endl;
+#endif
+    cout << endl;
+}
+
 int main()
 {
     int size = 10;
@@ -291,8 +1035,21 @@ int main()
     cout << "归并排序（逆序）耗时：" << duration << "秒" << endl
          << endl;
 
+    temp = shuffledVec;
+    start = clock();
+    radixSort(temp);
+    end = clock();
+    duration = (double)(end - start) / CLOCKS_PER_SEC;
+    cout << "基数排序（乱序）耗时：" << duration << "秒" << (temp == sortedVec ? "" : "（与归并排序结果不一致）") << endl
+         << endl;
+
+    testLargeSort();
+    testUnique();
+    testRangeIndex();
+    testComplexVector();
+
     double m1 = 2.0, m2 = 5.0;
-    vector<Complex> rangeResult = rangeSearch(sortedVec, m1, m2);
+    vector<Complex> rangeResult = ModulusIndex(sortedVec).rangeSearch(m1, m2);
     ss.clear();
     ss << "模介于[" << m1 << ", " << m2 << ")的元素：";
     printVector(rangeResult, ss.str());
@@ -4,33 +4,76 @@
 #include <cstdlib>
 #include <cmath>
 #include <cctype>
+#include <vector>
+#include <ctime>
+#include <cstring>
+#include <map>
+#include <tuple>
+#include <algorithm>
+#include <string_view>
+#include <charconv>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <utility>
+#include <type_traits>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+// x86-64上启用JIT，其他架构退回字节码解释器
+#if defined(__x86_64__) || defined(_M_X64)
+#define EXPR_JIT 1
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
 using namespace std;
 
-/* 顺序栈 */
-template <typename T>
+/* 顺序栈：前N个元素存放在对象内部，不做堆分配；超出后在堆上按2倍扩容
+   clear()只析构元素、保留已扩充的空间，同一个栈可在多次求值之间重复使用 */
+template <typename T, int N = 32>
 class Stack
 {
 public:
-    explicit Stack(int sz = 200)
+    Stack() : elem(local()), top(-1), capacity(N) {}
+    ~Stack()
     {
-        elem = new T[sz];
-        top = -1;
-        capacity = sz;
+        clear();
+        if (elem != local())
+            ::operator delete(elem);
     }
-    ~Stack() { delete[] elem; }
+    Stack(const Stack &) = delete;
+    Stack &operator=(const Stack &) = delete;
+
     bool empty() const { return top == -1; }
-    bool full() const { return top == capacity - 1; }
-    void push(const T &x)
+    int size() const { return top + 1; }
+    void push(const T &x) { emplace(x); }
+    void push(T &&x) { emplace(std::move(x)); }
+    template <typename... Args>
+    T &emplace(Args &&...args)
     {
-        if (full())
-            throw "栈溢出";
-        elem[++top] = x;
+        if (top + 1 == capacity)
+            grow(std::forward<Args>(args)...);
+        else
+            new (elem + top + 1) T(std::forward<Args>(args)...);
+        return elem[++top];
     }
     T pop()
     {
         if (empty())
             throw "栈下溢";
-        return elem[top--];
+        T x = std::move(elem[top]);
+        elem[top--].~T();
+        return x;
     }
     T &peek()
     {
@@ -38,14 +81,47 @@ public:
             throw "栈空";
         return elem[top];
     }
+    void clear()
+    {
+        while (top >= 0)
+            elem[top--].~T();
+    }
 
 private:
+    alignas(T) unsigned char buf[N * sizeof(T)]; // 内部存储
     T *elem;
     int top;
     int capacity;
+
+    T *local() { return reinterpret_cast<T *>(buf); }
+
+    // 扩容并在新空间中构造新元素：先构造再搬动旧元素，参数引用栈内元素（如push(peek())）时仍然有效
+    template <typename... Args>
+    void grow(Args &&...args)
+    {
+        T *p = static_cast<T *>(::operator new(sizeof(T) * capacity * 2));
+        try
+        {
+            new (p + top + 1) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            ::operator delete(p);
+            throw;
+        }
+        for (int i = 0; i <= top; ++i)
+        {
+            new (p + i) T(std::move(elem[i]));
+            elem[i].~T();
+        }
+        if (elem != local())
+            ::operator delete(elem);
+        elem = p;
+        capacity *= 2;
+    }
 };
 
-#define N_OPTR 9
+#define N_OPTR 10
 typedef enum
 {
     ADD,
@@ -56,21 +132,23 @@ typedef enum
     FAC,
     L_P,
     R_P,
-    EOE
+    EOE,
+    NEG // 单目负号（由词法位置区分，没有对应字符）
 } Operator;
 
 // 运算符优先级表（栈顶运算符 \ 当前运算符）
 const char pri[N_OPTR][N_OPTR] = {
-    /* +  -  *  /  ^  !  (  )  \0 */
-    {'>', '>', '<', '<', '<', '<', '<', '>', '>'}, // +
-    {'>', '>', '<', '<', '<', '<', '<', '>', '>'}, // -
-    {'>', '>', '>', '>', '<', '<', '<', '>', '>'}, // *
-    {'>', '>', '>', '>', '<', '<', '<', '>', '>'}, // /
-    {'>', '>', '>', '>', '>', '<', '<', '>', '>'}, // ^（幂运算，右结合）
-    {'>', '>', '>', '>', '>', '>', ' ', '>', '>'}, // !（阶乘，单目）
-    {'<', '<', '<', '<', '<', '<', '<', '=', ' '}, // (
-    {' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '}, // )
-    {'<', '<', '<', '<', '<', '<', '<', ' ', '='}  // EOE（结束符）
+    /* +  -  *  /  ^  !  (  )  \0  负 */
+    {'>', '>', '<', '<', '<', '<', '<', '>', '>', '<'}, // +
+    {'>', '>', '<', '<', '<', '<', '<', '>', '>', '<'}, // -
+    {'>', '>', '>', '>', '<', '<', '<', '>', '>', '<'}, // *
+    {'>', '>', '>', '>', '<', '<', '<', '>', '>', '<'}, // /
+    {'>', '>', '>', '>', '>', '<', '<', '>', '>', '<'}, // ^（幂运算，右结合）
+    {'>', '>', '>', '>', '>', '>', ' ', '>', '>', '<'}, // !（阶乘，单目）
+    {'<', '<', '<', '<', '<', '<', '<', '=', ' ', '<'}, // (
+    {' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '}, // )
+    {'<', '<', '<', '<', '<', '<', '<', ' ', '=', '<'}, // EOE（结束符）
+    {'>', '>', '>', '>', '<', '<', '<', '>', '>', '<'}  // 负号（低于^和!：-2^2 = -4）
 };
 
 // 字符转运算符索引
@@ -102,18 +180,6 @@ int op2idx(char c)
     }
 }
 
-// 优先级关系转数字（<:1, =:2, >:3）
-int relOp(char r)
-{
-    if (r == '<')
-        return 1;
-    if (r == '=')
-        return 2;
-    if (r == '>')
-        return 3;
-    return 0;
-}
-
 // 计算阶乘（辅助函数）
 double factorial(int n)
 {
@@ -149,245 +215,2967 @@ double calc(double a, char op, double b = 0)
     }
 }
 
-// 字符串转double
-double str2double(const string &s)
+/* ---------- 函数注册表：函数名在编译时经散列表解析为编号，求值时按编号直接调用 ---------- */
+
+#define MAX_ARITY 8 // 函数参数个数上限
+
+// 函数实现：args[0..arity)为参数，定义域错误时把err置为错误信息（不抛异常）
+typedef double (*FuncPtr)(const double *args, const char *&err);
+
+// 内置函数编号（注册表构造时按此顺序注册，批量求值和JIT对前几个单参数函数有专门实现）
+typedef enum
+{
+    F_SIN,
+    F_COS,
+    F_TAN,
+    F_LOG,
+    F_LN,
+    F_SQRT,
+    F_ABS,
+    F_EXP,
+    F_FLOOR,
+    F_MAX,
+    F_MIN,
+    F_ATAN2,
+    N_FUNC
+} FuncId;
+
+double fnSin(const double *a, const char *&) { return sin(a[0]); }
+double fnCos(const double *a, const char *&) { return cos(a[0]); }
+double fnTan(const double *a, const char *&) { return tan(a[0]); }
+double fnLog(const double *a, const char *&err) // 常用对数（底10）
+{
+    if (a[0] <= 0)
+        err = "log参数必须为正";
+    return log10(a[0]);
+}
+double fnLn(const double *a, const char *&err) // 自然对数（底e）
+{
+    if (a[0] <= 0)
+        err = "ln参数必须为正";
+    return log(a[0]);
+}
+double fnSqrt(const double *a, const char *&err)
 {
-    return strtod(s.c_str(), NULL);
+    if (a[0] < 0)
+        err = "sqrt参数不能为负";
+    return sqrt(a[0]);
 }
+double fnAbs(const double *a, const char *&) { return fabs(a[0]); }
+double fnExp(const double *a, const char *&) { return exp(a[0]); }
+double fnFloor(const double *a, const char *&) { return floor(a[0]); }
+double fnMax(const double *a, const char *&) { return max(a[0], a[1]); }
+double fnMin(const double *a, const char *&) { return min(a[0], a[1]); }
+double fnAtan2(const double *a, const char *&) { return atan2(a[0], a[1]); }
 
-/* 预处理：1.去空白 2.全角转半角 3.处理负号（插入0） */
-string preprocess(const string &in)
+class FuncRegistry
 {
-    string out;
-    for (size_t i = 0; i < in.size(); ++i)
+public:
+    FuncRegistry()
     {
-        unsigned char c = in[i];
-        // 1. 跳过所有空白（全角空格、半角空格、TAB等）
-        if (isspace(c))
-            continue;
-        if (c == 0xe3 && i + 2 < in.size() && in[i + 1] == 0x80 && in[i + 2] == 0x80)
+        const char *names[N_FUNC] = {"sin", "cos", "tan", "log", "ln", "sqrt",
+                                     "abs", "exp", "floor", "max", "min", "atan2"};
+        const FuncPtr impls[N_FUNC] = {fnSin, fnCos, fnTan, fnLog, fnLn, fnSqrt,
+                                       fnAbs, fnExp, fnFloor, fnMax, fnMin, fnAtan2};
+        for (int i = 0; i < N_FUNC; ++i)
+            add(names[i], i < F_MAX ? 1 : 2, impls[i]);
+    }
+
+    // 注册函数，返回编号；pure表示结果只取决于参数（可常量折叠、合并相同调用）
+    int add(const string &name, int arity, FuncPtr fn, bool pure = true)
+    {
+        if (arity < 0 || arity > MAX_ARITY)
+            throw "参数个数超出范围";
+        if (find(name) >= 0)
+            throw "函数重复定义";
+        funcs.push_back({name, arity, fn, pure});
+        if (funcs.size() * 2 > slots.size())
+            rehash(max<size_t>(16, slots.size() * 2));
+        else
+            insert(funcs.size() - 1);
+        return funcs.size() - 1;
+    }
+
+    // 函数名转编号，未知函数返回-1
+    int find(string_view name) const
+    {
+        if (slots.empty())
+            return -1;
+        size_t mask = slots.size() - 1;
+        for (size_t h = hash(name) & mask;; h = (h + 1) & mask)
         {
-            i += 2;
-            continue;
+            int id = slots[h];
+            if (id < 0 || funcs[id].name == name)
+                return id;
         }
-        // 2. 全角字符转半角（数字、运算符、括号）
-        if (c >= 0xff01 && c <= 0xff5e)
-        {                      // 全角符号范围
-            out += c - 0xfee0; // 全角→半角（差值0xfee0）
-            continue;
+    }
+
+    int arity(int id) const
+    {
+        return funcs[id].arity;
+    }
+
+    bool pure(int id) const
+    {
+        return funcs[id].pure;
+    }
+
+    const string &name(int id) const
+    {
+        return funcs[id].name;
+    }
+
+    // 不抛异常的调用，出错时err非空
+    double call(int id, const double *args, const char *&err) const
+    {
+        return funcs[id].fn(args, err);
+    }
+
+    double call(int id, const double *args) const
+    {
+        const char *err = nullptr;
+        double r = funcs[id].fn(args, err);
+        if (err != nullptr)
+            throw err;
+        return r;
+    }
+
+    int size() const
+    {
+        return funcs.size();
+    }
+
+private:
+    struct Entry
+    {
+        string name;
+        int arity;
+        FuncPtr fn;
+        bool pure;
+    };
+
+    vector<Entry> funcs;
+    vector<int> slots; // 开放定址（线性探测）散列表，存函数编号，-1为空；容量为2的幂，装载率不超过1/2
+
+    // FNV-1a
+    static size_t hash(string_view s)
+    {
+        size_t h = 14695981039346656037ULL;
+        for (char c : s)
+            h = (h ^ (unsigned char)c) * 1099511628211ULL;
+        return h;
+    }
+
+    void insert(int id)
+    {
+        size_t mask = slots.size() - 1;
+        size_t h = hash(funcs[id].name) & mask;
+        while (slots[h] >= 0)
+            h = (h + 1) & mask;
+        slots[h] = id;
+    }
+
+    void rehash(size_t cap)
+    {
+        slots.assign(cap, -1);
+        for (size_t i = 0; i < funcs.size(); ++i)
+            insert(i);
+    }
+};
+
+FuncRegistry registry; // 全局函数表，求值前注册完毕，之后只读
+
+/* 函数调用处理（单参数函数，按名字调用） */
+double callFunc(const string &name, double arg)
+{
+    int id = registry.find(name);
+    if (id < 0)
+        throw "未知函数";
+    if (registry.arity(id) != 1)
+        throw "参数个数错误";
+    return registry.call(id, &arg);
+}
+
+/* ---------- 求值的值类型：double、对偶数（前向自动微分）、区间 ---------- */
+
+// 解释器按值类型模板化，各运算通过下面的重载实现；double版本与原先逐条计算的代码相同
+
+inline bool divByZero(double b)
+{
+    return fabs(b) < 1e-12;
+}
+
+inline double vpow(double a, double b, const char *&)
+{
+    return pow(a, b);
+}
+
+inline const char *vfac(double &a)
+{
+    if ((int)a < 0)
+        return "阶乘负数错误";
+    a = factorial((int)a);
+    return nullptr;
+}
+
+inline double vfunc(int id, const double *a, const char *&err)
+{
+    return registry.call(id, a, err);
+}
+
+// 对偶数 v + d·ε（ε² = 0）：d随计算一起传播，即为对所选方向的导数
+struct Dual
+{
+    double v, d;
+
+    Dual(double val = 0, double der = 0) : v(val), d(der) {}
+};
+
+inline Dual operator+(Dual a, Dual b) { return Dual(a.v + b.v, a.d + b.d); }
+inline Dual operator-(Dual a, Dual b) { return Dual(a.v - b.v, a.d - b.d); }
+inline Dual operator*(Dual a, Dual b) { return Dual(a.v * b.v, a.d * b.v + a.v * b.d); }
+inline Dual operator/(Dual a, Dual b) { return Dual(a.v / b.v, (a.d * b.v - a.v * b.d) / (b.v * b.v)); }
+inline Dual operator-(Dual a) { return Dual(-a.v, -a.d); }
+
+inline bool divByZero(Dual b)
+{
+    return fabs(b.v) < 1e-12;
+}
+
+inline Dual vpow(Dual a, Dual b, const char *&)
+{
+    double p = pow(a.v, b.v);
+    if (b.d == 0) // 指数为常数：底数可以为负
+        return Dual(p, b.v * pow(a.v, b.v - 1) * a.d);
+    return Dual(p, p * (b.d * log(a.v) + b.v * a.d / a.v));
+}
+
+inline const char *vfac(Dual &a)
+{
+    if ((int)a.v < 0)
+        return "阶乘负数错误";
+    a = Dual(factorial((int)a.v), 0); // 阶乘按整数取值，分段为常数
+    return nullptr;
+}
+
+Dual vfunc(int id, const Dual *a, const char *&err)
+{
+    double v = a[0].v, d = a[0].d;
+    switch (id)
+    {
+    case F_SIN:
+        return Dual(sin(v), cos(v) * d);
+    case F_COS:
+        return Dual(cos(v), -sin(v) * d);
+    case F_TAN:
+        return Dual(tan(v), d / (cos(v) * cos(v)));
+    case F_LOG:
+        if (v <= 0)
+            err = "log参数必须为正";
+        return Dual(log10(v), d / (v * 2.30258509299404568402));
+    case F_LN:
+        if (v <= 0)
+            err = "ln参数必须为正";
+        return Dual(log(v), d / v);
+    case F_SQRT:
+        if (v < 0)
+            err = "sqrt参数不能为负";
+        return Dual(sqrt(v), d / (2 * sqrt(v)));
+    case F_ABS:
+        return Dual(fabs(v), v < 0 ? -d : d);
+    case F_EXP:
+        return Dual(exp(v), exp(v) * d);
+    case F_FLOOR:
+        return Dual(floor(v), 0);
+    case F_MAX:
+        return a[0].v >= a[1].v ? a[0] : a[1];
+    case F_MIN:
+        return a[0].v <= a[1].v ? a[0] : a[1];
+    case F_ATAN2:
+    {
+        double y = a[0].v, x = a[1].v;
+        return Dual(atan2(y, x), (x * a[0].d - y * a[1].d) / (x * x + y * y));
+    }
+    }
+    // 用户注册的函数没有导数公式：对每个导数非零的参数做中心差分
+    int k = registry.arity(id);
+    double args[MAX_ARITY] = {};
+    for (int i = 0; i < k; ++i)
+        args[i] = a[i].v;
+    Dual r(registry.call(id, args, err), 0);
+    for (int i = 0; i < k && err == nullptr; ++i)
+        if (a[i].d != 0)
+        {
+            double h = 1e-6 * max(1.0, fabs(args[i]));
+            args[i] = a[i].v + h;
+            double f1 = registry.call(id, args, err);
+            args[i] = a[i].v - h;
+            double f0 = registry.call(id, args, err);
+            args[i] = a[i].v;
+            r.d += (f1 - f0) / (2 * h) * a[i].d;
         }
-        // 3. 全角括号单独处理（避免上述范围遗漏）
-        if (c == 0xe3 && i + 2 < in.size())
+    return r;
+}
+
+// 区间[lo, hi]：结果区间包含自变量在各自区间内取值时表达式的所有可能值（不做向外舍入）
+struct Interval
+{
+    double lo, hi;
+
+    Interval(double v = 0) : lo(v), hi(v) {}
+    Interval(double l, double h) : lo(l), hi(h) {}
+};
+
+inline Interval operator+(Interval a, Interval b) { return Interval(a.lo + b.lo, a.hi + b.hi); }
+inline Interval operator-(Interval a, Interval b) { return Interval(a.lo - b.hi, a.hi - b.lo); }
+inline Interval operator-(Interval a) { return Interval(-a.hi, -a.lo); }
+inline Interval operator*(Interval a, Interval b)
+{
+    double p1 = a.lo * b.lo, p2 = a.lo * b.hi, p3 = a.hi * b.lo, p4 = a.hi * b.hi;
+    return Interval(min(min(p1, p2), min(p3, p4)), max(max(p1, p2), max(p3, p4)));
+}
+inline Interval operator/(Interval a, Interval b)
+{
+    return a * Interval(1 / b.hi, 1 / b.lo);
+}
+
+// 除数区间与(-1e-12, 1e-12)相交即可能除零
+inline bool divByZero(Interval b)
+{
+    return b.lo < 1e-12 && b.hi > -1e-12;
+}
+
+// 函数f在区间端点的值，用于单调函数
+template <typename F>
+inline Interval monotone(Interval a, F f, bool increasing = true)
+{
+    return increasing ? Interval(f(a.lo), f(a.hi)) : Interval(f(a.hi), f(a.lo));
+}
+
+Interval vpow(Interval a, Interval b, const char *&err)
+{
+    if (b.lo == b.hi && b.lo == floor(b.lo) && fabs(b.lo) <= 1024) // 整数次幂
+    {
+        int k = (int)b.lo;
+        if (k < 0)
         {
-            if (in[i + 1] == 0x80 && in[i + 2] == 0x88)
-            {
-                out += '(';
-                i += 2;
-                continue;
-            }
-            if (in[i + 1] == 0x80 && in[i + 2] == 0x89)
+            if (divByZero(a))
             {
-                out += ')';
-                i += 2;
-                continue;
+                err = "除零错误";
+                return a;
             }
+            return Interval(1) / vpow(a, Interval(-k), err);
         }
-        out += c;
+        double l = pow(a.lo, k), h = pow(a.hi, k);
+        if (k % 2 == 1)
+            return Interval(l, h);
+        if (a.lo <= 0 && a.hi >= 0)
+            return Interval(k == 0 ? 1 : 0, max(l, h));
+        return Interval(min(l, h), max(l, h));
     }
-    // 4. 处理负号：在开头或'('后添加0（如 "-1"→"0-1"，"( -2"→"(0-2"）
-    string res;
-    for (size_t i = 0; i < out.size(); ++i)
+    if (a.lo <= 0)
     {
-        if (out[i] == '-' && (i == 0 || out[i - 1] == '(' || op2idx(out[i - 1]) != -1))
-        {
-            res += '0'; // 插入0，将负号转为双目运算符
-        }
-        res += out[i];
+        err = "非整数次幂的底数区间必须为正";
+        return a;
     }
-    return res;
+    // 底数为正时pow对每个参数单调，极值在四个角上
+    double p1 = pow(a.lo, b.lo), p2 = pow(a.lo, b.hi), p3 = pow(a.hi, b.lo), p4 = pow(a.hi, b.hi);
+    return Interval(min(min(p1, p2), min(p3, p4)), max(max(p1, p2), max(p3, p4)));
 }
 
-/* 函数调用处理（sin/cos/tan/log/ln/sqrt） */
-double callFunc(const string &name, double arg)
+inline const char *vfac(Interval &a)
+{
+    if ((int)a.lo < 0)
+        return "阶乘负数错误";
+    a = Interval(factorial((int)a.lo), factorial((int)a.hi));
+    return nullptr;
+}
+
+// [lo, hi]中是否有 phase + 2kπ
+inline bool containsPeriodic(double lo, double hi, double phase)
 {
-    if (name == "sin")
-        return sin(arg);
-    if (name == "cos")
-        return cos(arg);
-    if (name == "tan")
-        return tan(arg);
-    if (name == "log")
-    { // 常用对数（底10）
-        if (arg <= 0)
-            throw "log参数必须为正";
-        return log10(arg);
+    const double TWO_PI = 6.28318530717958647692;
+    return phase + TWO_PI * ceil((lo - phase) / TWO_PI) <= hi;
+}
+
+inline Interval sinInterval(Interval a)
+{
+    const double HALF_PI = 1.57079632679489661923;
+    double l = sin(a.lo), h = sin(a.hi);
+    Interval r(min(l, h), max(l, h));
+    if (containsPeriodic(a.lo, a.hi, HALF_PI))
+        r.hi = 1;
+    if (containsPeriodic(a.lo, a.hi, -HALF_PI))
+        r.lo = -1;
+    return r;
+}
+
+Interval vfunc(int id, const Interval *a, const char *&err)
+{
+    const double PI = 3.14159265358979323846;
+    Interval x = a[0];
+    switch (id)
+    {
+    case F_SIN:
+        return sinInterval(x);
+    case F_COS:
+        return sinInterval(x + Interval(PI / 2));
+    case F_TAN:
+        if (x.hi - x.lo >= PI || containsPeriodic(x.lo, x.hi, PI / 2) || containsPeriodic(x.lo, x.hi, -PI / 2))
+            err = "tan的区间跨越间断点";
+        return monotone(x, [](double v) { return tan(v); });
+    case F_LOG:
+        if (x.lo <= 0)
+            err = "log参数必须为正";
+        return monotone(x, [](double v) { return log10(v); });
+    case F_LN:
+        if (x.lo <= 0)
+            err = "ln参数必须为正";
+        return monotone(x, [](double v) { return log(v); });
+    case F_SQRT:
+        if (x.lo < 0)
+            err = "sqrt参数不能为负";
+        return monotone(x, [](double v) { return sqrt(v); });
+    case F_ABS:
+        if (x.lo >= 0)
+            return x;
+        if (x.hi <= 0)
+            return -x;
+        return Interval(0, max(-x.lo, x.hi));
+    case F_EXP:
+        return monotone(x, [](double v) { return exp(v); });
+    case F_FLOOR:
+        return monotone(x, [](double v) { return floor(v); });
+    case F_MAX:
+        return Interval(max(a[0].lo, a[1].lo), max(a[0].hi, a[1].hi));
+    case F_MIN:
+        return Interval(min(a[0].lo, a[1].lo), min(a[0].hi, a[1].hi));
+    case F_ATAN2:
+    {
+        Interval y = a[0];
+        if (x.lo <= 0) // 可能跨越负实轴上的间断：取整个值域
+            return Interval(-PI, PI);
+        double p1 = atan2(y.lo, x.lo), p2 = atan2(y.lo, x.hi), p3 = atan2(y.hi, x.lo), p4 = atan2(y.hi, x.hi);
+        return Interval(min(min(p1, p2), min(p3, p4)), max(max(p1, p2), max(p3, p4)));
     }
-    if (name == "ln")
-    { // 自然对数（底e）
-        if (arg <= 0)
-            throw "ln参数必须为正";
-        return log(arg);
     }
-    if (name == "sqrt")
+    err = "该函数不支持区间求值";
+    return x;
+}
+
+/* ---------- 列式批量求值用的向量核心：每个运算符作为一个整块循环执行 ---------- */
+
+const int BATCH = 1024; // 每块处理的行数
+
+// a[i] op= b[i]，显式SIMD（编译时启用AVX则一次4个，否则由编译器自动向量化）
+#define VEC_BINARY_KERNEL(name, expr, intrin)                     \
+    inline void name(double *a, const double *b, int n)           \
+    {                                                             \
+        int i = 0;                                                \
+        VEC_AVX_LOOP(intrin)                                      \
+        for (; i < n; ++i)                                        \
+            a[i] = expr;                                          \
+    }
+#ifdef __AVX__
+#define VEC_AVX_LOOP(intrin)                                                                  \
+    for (; i + 4 <= n; i += 4)                                                                \
+        _mm256_storeu_pd(a + i, intrin(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+#else
+#define VEC_AVX_LOOP(intrin)
+#endif
+VEC_BINARY_KERNEL(vecAdd, a[i] + b[i], _mm256_add_pd)
+VEC_BINARY_KERNEL(vecSub, a[i] - b[i], _mm256_sub_pd)
+VEC_BINARY_KERNEL(vecMul, a[i] * b[i], _mm256_mul_pd)
+VEC_BINARY_KERNEL(vecDiv, a[i] / b[i], _mm256_div_pd)
+#undef VEC_AVX_LOOP
+#undef VEC_BINARY_KERNEL
+
+// a[i] = sqrt(a[i])（调用前已检查非负）
+inline void vecSqrt(double *a, int n)
+{
+    int i = 0;
+#if defined(__AVX__)
+    for (; i + 4 <= n; i += 4)
+        _mm256_storeu_pd(a + i, _mm256_sqrt_pd(_mm256_loadu_pd(a + i)));
+#elif defined(__SSE2__)
+    for (; i + 2 <= n; i += 2)
+        _mm_storeu_pd(a + i, _mm_sqrt_pd(_mm_loadu_pd(a + i)));
+#endif
+    for (; i < n; ++i)
+        a[i] = sqrt(a[i]);
+}
+
+// 快速近似sin：先归约到[-π, π]，再对称到[-π/2, π/2]，用11次泰勒多项式（误差约1e-7），无分支可向量化
+inline void vecFastSin(double *a, int n)
+{
+    const double PI = 3.14159265358979323846;
+    for (int i = 0; i < n; ++i)
+    {
+        double x = a[i];
+        x -= 2 * PI * nearbyint(x * (0.5 / PI));
+        double h = x > 0 ? PI - x : -PI - x; // sin(x) = sin(±π - x)
+        x = fabs(x) > PI / 2 ? h : x;
+        double x2 = x * x;
+        a[i] = x * (1 + x2 * (-1.0 / 6 + x2 * (1.0 / 120 + x2 * (-1.0 / 5040 + x2 * (1.0 / 362880 + x2 * (-1.0 / 39916800))))));
+    }
+}
+
+inline void vecFastCos(double *a, int n)
+{
+    for (int i = 0; i < n; ++i)
+        a[i] += 1.57079632679489661923; // cos(x) = sin(x + π/2)
+    vecFastSin(a, n);
+}
+
+// 快速近似ln（x > 0）：x = m·2^e，m∈[√½, √2)，ln m 用 atanh 级数（误差约1e-9）
+inline void vecFastLn(double *a, int n)
+{
+    for (int i = 0; i < n; ++i)
     {
-        if (arg < 0)
-            throw "sqrt参数不能为负";
-        return sqrt(arg);
+        unsigned long long bits;
+        memcpy(&bits, &a[i], 8);
+        long long e = (long long)((bits >> 52) & 0x7ff) - 1023;
+        bits = (bits & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL; // m∈[1, 2)
+        double m;
+        memcpy(&m, &bits, 8);
+        double adj = m > 1.41421356237309505 ? 1.0 : 0.0;
+        m *= adj > 0 ? 0.5 : 1.0;
+        double s = (m - 1) / (m + 1), s2 = s * s;
+        double lnm = 2 * s * (1 + s2 * (1.0 / 3 + s2 * (1.0 / 5 + s2 * (1.0 / 7 + s2 * (1.0 / 9 + s2 * (1.0 / 11))))));
+        a[i] = (e + adj) * 0.69314718055994530942 + lnm;
     }
-    throw "未知函数";
 }
 
-/* 表达式求值核心 */
-double evaluate(const string &expr)
+/* ---------- 表达式编译：一次解析为后缀字节码，变量在求值时绑定 ---------- */
+
+// 字节码指令类型
+typedef enum
+{
+    OP_CONST, // 压入常量
+    OP_VAR,   // 压入变量
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_POW,
+    OP_FAC,   // 阶乘（单目）
+    OP_NEG,   // 取负（单目）
+    OP_FUNC,  // 调用函数（参数个数由注册表给出，参数依次在栈顶）
+    OP_STORE, // 栈顶复制到临时变量（不出栈），用于公共子表达式
+    OP_LOAD   // 压入临时变量
+} OpCode;
+
+struct Instr
+{
+    OpCode op;
+    int arg;    // OP_VAR：变量下标；OP_FUNC：函数编号；OP_STORE/OP_LOAD：临时变量下标
+    double val; // OP_CONST：常量值
+};
+
+// 不抛异常的接口返回的状态
+typedef enum
+{
+    EXPR_OK,
+    EXPR_SYNTAX_ERROR, // 语法错误
+    EXPR_NAME_ERROR,   // 未知函数或变量
+    EXPR_MATH_ERROR    // 求值错误（除零、定义域）
+} ExprStatus;
+
+// 编译或求值的结果：成功时value有效；失败时msg为原因，pos为出错的字节位置（求值错误没有位置，为NO_POS）
+struct ExprResult
+{
+    static const size_t NO_POS = (size_t)-1;
+
+    ExprStatus status;
+    size_t pos;
+    const char *msg;
+    double value;
+
+    bool ok() const
+    {
+        return status == EXPR_OK;
+    }
+};
+
+// 编译后的表达式：后缀指令序列，求值只需一个紧凑的解释循环
+class CompiledExpr
 {
-    string src = preprocess(expr);
-    Stack<double> opnd;   // 操作数栈
-    Stack<char> optr;     // 运算符栈
-    optr.push('#');       // 栈底哨兵
-    string s = src + '#'; // 表达式末尾添加哨兵
-    size_t i = 0;
+public:
+    vector<Instr> code;
+    vector<string> vars; // 变量名，下标即求值时参数数组中的位置
+    int maxDepth;        // 求值所需的最大栈深度
+    int nTemps;          // 临时变量个数，存放在栈空间的maxDepth之后
+
+    CompiledExpr() : maxDepth(0), nTemps(0) {}
 
-    while (i < s.size())
+    // 求值所需的栈空间大小（操作数栈+临时变量）
+    int frameSize() const
     {
-        char c = s[i];
-        // 1. 解析数字（含小数点）
-        if (isdigit(c) || c == '.')
+        return maxDepth + nTemps;
+    }
+
+    // 模拟一遍求值得到最大栈深度
+    void computeDepth()
+    {
+        int depth = 0;
+        maxDepth = 0;
+        for (const Instr &in : code)
         {
-            string numStr;
-            while (i < s.size() && (isdigit(s[i]) || s[i] == '.'))
-            {
-                numStr += s[i++];
-            }
-            opnd.push(str2double(numStr));
-            continue;
-        }
-        // 2. 解析函数（字母开头，如sin、log）
-        if (isalpha(c))
-        {
-            string fname;
-            while (i < s.size() && isalpha(s[i]))
-            {
-                fname += s[i++];
-            }
-            if (s[i] != '(')
-                throw "函数后必须跟'('";
-            ++i;         // 跳过'('
-            int dep = 1; // 括号深度（处理嵌套括号）
-            string subExpr;
-            while (i < s.size() && dep > 0)
-            {
-                if (s[i] == '(')
-                    dep++;
-                else if (s[i] == ')')
-                    dep--;
-                if (dep > 0)
-                    subExpr += s[i++];
-            }
-            if (dep != 0)
-                throw "函数括号不匹配";
-            ++i;                            // 跳过')'
-            double arg = evaluate(subExpr); // 递归计算函数参数
-            opnd.push(callFunc(fname, arg));
-            continue;
+            if (in.op == OP_CONST || in.op == OP_VAR || in.op == OP_LOAD)
+                depth++;
+            else if (in.op >= OP_ADD && in.op <= OP_POW)
+                depth--;
+            else if (in.op == OP_FUNC)
+                depth -= registry.arity(in.arg) - 1;
+            maxDepth = max(maxDepth, depth);
         }
-        // 3. 处理运算符（含哨兵#）
-        char topOp = optr.peek();
-        int idx1 = op2idx(topOp), idx2 = op2idx(c);
-        if (idx1 < 0 || idx2 < 0)
-            throw "非法字符";
+    }
 
-        int rel = relOp(pri[idx1][idx2]);
-        if (rel == 1)
-        { // 栈顶优先级低：当前运算符入栈
-            optr.push(c);
-            i++;
-        }
-        else if (rel == 2)
-        { // 优先级相等（如()、##）：弹出栈顶，跳过当前字符
-            optr.pop();
-            i++;
-        }
-        else if (rel == 3)
-        { // 栈顶优先级高：执行运算
-            char op = optr.pop();
-            // 区分单目运算符（!）和双目运算符
-            if (op == '!')
+    // 求值核心：x[i]为第i个变量的值，stack为调用者提供的至少frameSize()个元素的栈空间
+    // 不抛异常：成功时返回nullptr并写入result，出错时返回错误信息
+    // V为值类型：double为普通求值，Dual同时求方向导数，Interval求取值范围
+    template <typename V>
+    const char *exec(const V *x, V *stack, V &result) const
+    {
+        V *st = stack;
+        V *tmp = stack + maxDepth;
+        int sp = -1;
+        for (const Instr &in : code)
+        {
+            switch (in.op)
             {
-                double a = opnd.pop();
-                opnd.push(calc(a, op)); // 单目运算，仅传a和op
+            case OP_CONST:
+                st[++sp] = V(in.val);
+                break;
+            case OP_VAR:
+                st[++sp] = x[in.arg];
+                break;
+            case OP_ADD:
+                st[sp - 1] = st[sp - 1] + st[sp];
+                sp--;
+                break;
+            case OP_SUB:
+                st[sp - 1] = st[sp - 1] - st[sp];
+                sp--;
+                break;
+            case OP_MUL:
+                st[sp - 1] = st[sp - 1] * st[sp];
+                sp--;
+                break;
+            case OP_DIV:
+                if (divByZero(st[sp]))
+                    return "除零错误";
+                st[sp - 1] = st[sp - 1] / st[sp];
+                sp--;
+                break;
+            case OP_POW:
+            {
+                const char *err = nullptr;
+                st[sp - 1] = vpow(st[sp - 1], st[sp], err);
+                if (err != nullptr)
+                    return err;
+                sp--;
+                break;
             }
-            else
+            case OP_FAC:
             {
-                double b = opnd.pop();
-                double a = opnd.pop();
-                opnd.push(calc(a, op, b)); // 双目运算，传a、op、b
+                const char *err = vfac(st[sp]);
+                if (err != nullptr)
+                    return err;
+                break;
+            }
+            case OP_NEG:
+                st[sp] = -st[sp];
+                break;
+            case OP_FUNC:
+            {
+                const char *err = nullptr;
+                sp -= registry.arity(in.arg) - 1;
+                st[sp] = vfunc(in.arg, st + sp, err);
+                if (err != nullptr)
+                    return err;
+                break;
+            }
+            case OP_STORE:
+                tmp[in.arg] = st[sp];
+                break;
+            case OP_LOAD:
+                st[++sp] = tmp[in.arg];
+                break;
             }
         }
-        else
+        result = st[0];
+        return nullptr;
+    }
+
+    // 求值，出错时抛出错误信息
+    double eval(const double *x, double *stack) const
+    {
+        double r;
+        const char *err = exec(x, stack, r);
+        if (err != nullptr)
+            throw err;
+        return r;
+    }
+
+    // 栈较浅时使用局部数组，不做堆分配
+    double eval(const double *x = nullptr) const
+    {
+        if (frameSize() <= 64)
         {
-            throw "表达式语法错误";
+            double st[64];
+            return eval(x, st);
         }
+        vector<double> st(frameSize());
+        return eval(x, st.data());
     }
-    // 最终结果校验（操作数栈应只剩一个结果，运算符栈为空）
-    double ans = opnd.pop();
-    if (!opnd.empty() || !optr.empty())
-        throw "表达式异常";
-    return ans;
-}
 
-/* 测试函数 */
-int main()
-{
-    // 测试用例（覆盖基础运算、函数、负号、阶乘、全角）
-    const char *tests[] = {
-        "1 + 2 * 3",         // 基础运算
-        "(1 + 2) * 3",       // 括号
-        "3.5 / 2 + 1",       // 小数
-        "sin(0) + cos(0)",   // 三角函数
-        "ln(2.718281828)",   // 自然对数
-        "sqrt(16) * 2 + 1",  // 平方根
-        "1 + 2*(3+4)/5 - 6", // 混合运算
-        "tan(3.14159265/4)", // 正切（π/4≈0.785）
-        "log(100)",          // 常用对数
-        "-1 + 2",            // 负号（开头）
-        "1 + (-2)",          // 负号（括号内）
-        "5!",                // 阶乘
-        "2^3",               // 幂运算
-        "１＋２×３",         // 全角运算符
-        "1 + + 2",           // 非法表达式（连续+）
-        "5 / 0"              // 除零错误
-    };
+    // 按值类型V求值（如Dual、Interval），stack至少有frameSize()个元素，出错时抛出错误信息
+    template <typename V>
+    V evalAs(const V *x, V *stack) const
+    {
+        V r;
+        const char *err = exec(x, stack, r);
+        if (err != nullptr)
+            throw err;
+        return r;
+    }
 
-    int n = sizeof(tests) / sizeof(tests[0]);
-    for (int i = 0; i < n; ++i)
+    // 栈较浅时使用未初始化的局部缓冲区：exec只写后读，不必逐个构造64个V
+    template <typename V>
+    V evalAs(const V *x) const
     {
-        cout << "表达式：" << tests[i] << endl;
-        try
+        static_assert(is_trivially_copyable<V>::value, "值类型须可按位复制");
+        if (frameSize() <= 64)
         {
-            cout << "结果 = " << evaluate(tests[i]) << endl;
+            alignas(V) unsigned char buf[64 * sizeof(V)];
+            return evalAs(x, reinterpret_cast<V *>(buf));
         }
-        catch (const char *e)
+        vector<V> st(frameSize());
+        return evalAs(x, st.data());
+    }
+
+    // 返回函数值并把梯度写入grad：每个变量做一遍对偶数求值，导数精确到舍入误差
+    // 对偶数输入和求值栈放在同一块缓冲区里，各变量的求值共用，整个调用至多一次堆分配
+    double gradient(const double *x, double *grad) const
+    {
+        size_t nv = vars.size(), need = nv + frameSize();
+        alignas(Dual) unsigned char buf[64 * sizeof(Dual)];
+        vector<Dual> heap;
+        Dual *xd = reinterpret_cast<Dual *>(buf);
+        if (need > 64)
         {
-            cout << "错误: " << e << " => 式子无效" << endl;
+            heap.resize(need);
+            xd = heap.data();
         }
-        cout << "-------------------------" << endl;
+        Dual *st = xd + nv;
+        for (size_t i = 0; i < nv; ++i)
+            xd[i] = Dual(x[i]);
+        Dual r;
+        if (nv == 0)
+            r = evalAs(xd, st);
+        for (size_t i = 0; i < nv; ++i)
+        {
+            xd[i].d = 1;
+            r = evalAs(xd, st);
+            xd[i].d = 0;
+            grad[i] = r.d;
+        }
+        return r.v;
     }
 
-    /* 交互模式（空行退出） */
-    cout << "请输入表达式（空行退出）：" << endl;
-    string line;
-    while (getline(cin, line))
+    // 不抛异常的求值
+    ExprResult tryEval(const double *x = nullptr) const
+    {
+        ExprResult res = {EXPR_OK, 0, nullptr, 0};
+        double local[64];
+        vector<double> heap;
+        double *st = local;
+        if (frameSize() > 64)
+        {
+            heap.resize(frameSize());
+            st = heap.data();
+        }
+        res.msg = exec(x, st, res.value);
+        if (res.msg != nullptr)
+        {
+            res.status = EXPR_MATH_ERROR;
+            res.pos = ExprResult::NO_POS;
+        }
+        return res;
+    }
+
+    // 列式批量求值：cols[i]指向第i个变量的n个取值，结果写入out[0..n)
+    // 每块BATCH行，逐条指令对整块执行；fastMath为真时sin/cos/tan/ln/log使用向量化的近似实现
+    void evalBatch(const double *const *cols, size_t n, double *out, bool fastMath = false) const
+    {
+        vector<double> regs((size_t)max(frameSize(), 1) * BATCH); // 每个栈槽、临时变量各一整块
+        for (size_t base = 0; base < n; base += BATCH)
+        {
+            int len = (int)min<size_t>(BATCH, n - base);
+            int sp = -1;
+            for (const Instr &in : code)
+            {
+                double *a = &regs[(size_t)(sp - 1 < 0 ? 0 : sp - 1) * BATCH]; // 次栈顶
+                double *b = &regs[(size_t)(sp < 0 ? 0 : sp) * BATCH];         // 栈顶
+                switch (in.op)
+                {
+                case OP_CONST:
+                    sp++;
+                    fill_n(&regs[(size_t)sp * BATCH], len, in.val);
+                    break;
+                case OP_VAR:
+                    sp++;
+                    memcpy(&regs[(size_t)sp * BATCH], cols[in.arg] + base, len * sizeof(double));
+                    break;
+                case OP_ADD:
+                    vecAdd(a, b, len);
+                    sp--;
+                    break;
+                case OP_SUB:
+                    vecSub(a, b, len);
+                    sp--;
+                    break;
+                case OP_MUL:
+                    vecMul(a, b, len);
+                    sp--;
+                    break;
+                case OP_DIV:
+                {
+                    // 先整块检查除数，再整块相除，检查循环同样可以向量化
+                    bool bad = false;
+                    for (int k = 0; k < len; ++k)
+                        bad |= fabs(b[k]) < 1e-12;
+                    if (bad)
+                        throw "除零错误";
+                    vecDiv(a, b, len);
+                    sp--;
+                    break;
+                }
+                case OP_POW:
+                    for (int k = 0; k < len; ++k)
+                        a[k] = pow(a[k], b[k]);
+                    sp--;
+                    break;
+                case OP_FAC:
+                    for (int k = 0; k < len; ++k)
+                        b[k] = factorial((int)b[k]);
+                    break;
+                case OP_NEG:
+                    for (int k = 0; k < len; ++k)
+                        b[k] = -b[k];
+                    break;
+                case OP_FUNC:
+                {
+                    int k = registry.arity(in.arg);
+                    if (k == 1)
+                    {
+                        funcBatch(in.arg, b, len, fastMath);
+                        break;
+                    }
+                    // 多参数：第j个参数在从结果块起的第j块中，逐行收集后调用
+                    sp -= k - 1;
+                    double *r = &regs[(size_t)sp * BATCH];
+                    double args[MAX_ARITY];
+                    for (int i = 0; i < len; ++i)
+                    {
+                        for (int j = 0; j < k; ++j)
+                            args[j] = r[(size_t)j * BATCH + i];
+                        r[i] = registry.call(in.arg, args);
+                    }
+                    break;
+                }
+                case OP_STORE:
+                    memcpy(&regs[(size_t)(maxDepth + in.arg) * BATCH], b, len * sizeof(double));
+                    break;
+                case OP_LOAD:
+                    sp++;
+                    memcpy(&regs[(size_t)sp * BATCH], &regs[(size_t)(maxDepth + in.arg) * BATCH], len * sizeof(double));
+                    break;
+                }
+            }
+            memcpy(out + base, &regs[0], len * sizeof(double));
+        }
+    }
+
+private:
+    // 对整块数据调用函数，定义域检查先于计算整块完成
+    static void funcBatch(int id, double *b, int len, bool fastMath)
+    {
+        double lo = b[0];
+        for (int k = 1; k < len; ++k)
+            lo = min(lo, b[k]);
+        switch (id)
+        {
+        case F_SQRT:
+            if (lo < 0)
+                throw "sqrt参数不能为负";
+            vecSqrt(b, len);
+            return;
+        case F_LN:
+        case F_LOG:
+            if (lo <= 0)
+                throw id == F_LN ? "ln参数必须为正" : "log参数必须为正";
+            if (fastMath)
+            {
+                vecFastLn(b, len);
+                if (id == F_LOG)
+                    for (int k = 0; k < len; ++k)
+                        b[k] *= 0.43429448190325182765; // 1/ln10
+                return;
+            }
+            break;
+        case F_SIN:
+            if (fastMath)
+            {
+                vecFastSin(b, len);
+                return;
+            }
+            break;
+        case F_COS:
+            if (fastMath)
+            {
+                vecFastCos(b, len);
+                return;
+            }
+            break;
+        case F_TAN:
+            if (fastMath)
+            {
+                double c[BATCH];
+                memcpy(c, b, len * sizeof(double));
+                vecFastSin(b, len);
+                vecFastCos(c, len);
+                for (int k = 0; k < len; ++k)
+                    b[k] /= c[k];
+                return;
+            }
+            break;
+        }
+        for (int k = 0; k < len; ++k)
+            b[k] = registry.call(id, &b[k]);
+    }
+};
+
+/* ---------- 词法分析：在string_view上单遍扫描，记号直接引用原串，不复制子串 ---------- */
+
+typedef enum
+{
+    TK_NUM,   // 数字
+    TK_IDENT, // 标识符（函数名或变量名）
+    TK_OP,    // 运算符或括号
+    TK_END,   // 表达式结束
+    TK_BAD    // 非法字符或数字格式错误（原因见Tokenizer::error）
+} TokenType;
+
+struct Token
+{
+    TokenType type;
+    double num;       // TK_NUM：数值
+    string_view name; // TK_IDENT：名字（指向原串）
+    char op;          // TK_OP：规范化后的半角字符
+    size_t pos;       // 起始字节位置
+};
+
+class Tokenizer
+{
+public:
+    const char *error; // 最近一个TK_BAD记号的错误信息
+
+    explicit Tokenizer(string_view src) : error(nullptr), s(src), i(0) {}
+
+    Token next()
+    {
+        size_t len;
+        skipSpace();
+        Token t = {TK_END, 0, string_view(), 0, i};
+        if (i >= s.size())
+            return t;
+        char c = charAt(i, len);
+        if (isdigit((unsigned char)c) || c == '.')
+            return number(t);
+        if (len == 1 && (isalpha((unsigned char)c) || c == '_'))
+        {
+            size_t j = i + 1;
+            while (j < s.size() && (isalnum((unsigned char)s[j]) || s[j] == '_'))
+                j++;
+            t.type = TK_IDENT;
+            t.name = s.substr(i, j - i);
+            i = j;
+            return t;
+        }
+        i += len;
+        if (c != '\0' && c != '#' && (op2idx(c) >= 0 || c == ','))
+        {
+            t.type = TK_OP;
+            t.op = c;
+        }
+        else
+            return bad(t, "非法字符");
+        return t;
+    }
+
+    // 跳过空白后下一个字符是否为c（不消耗）
+    bool nextIs(char c)
+    {
+        size_t len;
+        skipSpace();
+        return i < s.size() && charAt(i, len) == c;
+    }
+
+private:
+    string_view s;
+    size_t i;
+
+    // 读取位置p处的字符并规范为半角ASCII，len返回其字节数；不认识的非ASCII字符返回'\0'
+    char charAt(size_t p, size_t &len) const
+    {
+        unsigned char c = s[p];
+        len = 1;
+        if (c < 0x80)
+            return (char)c;
+        if (p + 2 < s.size() && c == 0xe3 && (unsigned char)s[p + 1] == 0x80)
+        {
+            unsigned char d = s[p + 2];
+            len = 3;
+            if (d == 0x80)
+                return ' '; // 全角空格U+3000
+            if (d == 0x88)
+                return '('; // 〈
+            if (d == 0x89)
+                return ')'; // 〉
+        }
+        if (p + 2 < s.size() && c == 0xef)
+        {
+            // 全角字符U+FF01~U+FF5E（EF BC 81 ~ EF BD 9E），减0xfee0得到半角
+            unsigned char d = s[p + 1], e = s[p + 2];
+            if ((d == 0xbc && e >= 0x81 && e <= 0xbf) || (d == 0xbd && e >= 0x80 && e <= 0x9e))
+            {
+                len = 3;
+                return (char)((0xff00 | (d & 0x03) << 6 | (e & 0x3f)) - 0xfee0);
+            }
+        }
+        if (p + 1 < s.size() && c == 0xc3)
+        {
+            unsigned char d = s[p + 1];
+            len = 2;
+            if (d == 0x97)
+                return '*'; // ×
+            if (d == 0xb7)
+                return '/'; // ÷
+        }
+        len = 1;
+        return '\0';
+    }
+
+    Token bad(Token t, const char *msg)
+    {
+        t.type = TK_BAD;
+        error = msg;
+        return t;
+    }
+
+    void skipSpace()
+    {
+        size_t len;
+        while (i < s.size())
+        {
+            char c = charAt(i, len);
+            if (!isspace((unsigned char)c) || c == '\0')
+                break;
+            i += len;
+        }
+    }
+
+    // 数字：半角直接在原串上from_chars；含全角数字时先规范化到小缓冲区
+    Token number(Token t)
+    {
+        const char *b = s.data() + i, *e = s.data() + s.size();
+        double v;
+        if ((unsigned char)s[i] < 0x80)
+        {
+            from_chars_result r = from_chars(b, e, v);
+            if (r.ec != errc())
+                return bad(t, "数字格式错误");
+            i = r.ptr - s.data();
+        }
+        else
+        {
+            char buf[64];
+            int n = 0;
+            size_t len;
+            for (char c; i < s.size() && (isdigit((unsigned char)(c = charAt(i, len))) || c == '.'); i += len)
+            {
+                if (n == (int)sizeof(buf))
+                    return bad(t, "数字过长");
+                buf[n++] = c;
+            }
+            from_chars_result r = from_chars(buf, buf + n, v);
+            if (r.ec != errc() || r.ptr != buf + n)
+                return bad(t, "数字格式错误");
+        }
+        t.type = TK_NUM;
+        t.num = v;
+        return t;
+    }
+};
+
+// 运算符下标转指令
+OpCode idx2code(int op)
+{
+    switch (op)
+    {
+    case ADD:
+        return OP_ADD;
+    case SUB:
+        return OP_SUB;
+    case MUL:
+        return OP_MUL;
+    case DIV:
+        return OP_DIV;
+    case POW:
+        return OP_POW;
+    case FAC:
+        return OP_FAC;
+    case NEG:
+        return OP_NEG;
+    default:
+        throw "非法运算符";
+    }
+}
+
+/* 编译核心：算符优先分析，一遍扫描按归约顺序输出后缀指令
+   函数调用与括号共用运算符栈：函数名后的'('入栈时在callee栈记下函数编号，与之匹配的')'出栈时检查参数个数并输出调用指令，
+   因此嵌套调用也不需要递归；'-'出现在需要操作数的位置即为单目负号 */
+// 编译用的栈，可在多次编译之间重复使用（如每个线程一份）
+struct ParseStacks
+{
+    Stack<int> optr;   // 运算符栈（运算符下标）
+    Stack<int> callee; // 与栈中每个'('对应：函数编号，普通括号为-1
+    Stack<int> nargs;  // 与栈中每个'('对应：已读完的参数个数（逗号数）
+};
+
+// 不抛异常的编译：结果写入ce，出错时返回状态、位置和原因（此时ce的内容无意义）
+ExprResult tryCompile(string_view expr, CompiledExpr &ce, const vector<string> &vars, ParseStacks &ps)
+{
+    auto fail = [](ExprStatus st, const char *msg, size_t pos)
+    {
+        return ExprResult{st, pos, msg, 0};
+    };
+    ce.vars = vars;
+    ce.code.clear();
+    ce.nTemps = 0;
+    vector<Instr> &code = ce.code;
+    Tokenizer lex(expr);
+    Stack<int> &optr = ps.optr, &callee = ps.callee, &nargs = ps.nargs;
+    optr.clear();
+    callee.clear();
+    nargs.clear();
+    optr.push(EOE); // 栈底哨兵
+    bool expectOperand = true;
+
+    for (;;)
+    {
+        Token t = lex.next();
+        if (t.type == TK_BAD)
+            return fail(EXPR_SYNTAX_ERROR, lex.error, t.pos);
+        // 1. 操作数：数字、变量，或函数调用的开始
+        if (t.type == TK_NUM || t.type == TK_IDENT)
+        {
+            if (!expectOperand)
+                return fail(EXPR_SYNTAX_ERROR, "缺少运算符", t.pos);
+            if (t.type == TK_NUM)
+            {
+                code.push_back({OP_CONST, 0, t.num});
+                expectOperand = false;
+                continue;
+            }
+            if (lex.nextIs('('))
+            {
+                int id = registry.find(t.name);
+                if (id < 0)
+                    return fail(EXPR_NAME_ERROR, "未知函数", t.pos);
+                lex.next(); // 跳过'('
+                optr.push(L_P);
+                callee.push(id);
+                nargs.push(0);
+                continue; // 仍然等待操作数（函数参数）
+            }
+            size_t v = 0;
+            while (v < vars.size() && vars[v] != t.name)
+                v++;
+            if (v == vars.size())
+                return fail(EXPR_NAME_ERROR, "未知变量", t.pos);
+            code.push_back({OP_VAR, (int)v, 0});
+            expectOperand = false;
+            continue;
+        }
+        // 2. 逗号：归约到最近的'('，该括号必须属于函数调用
+        if (t.type == TK_OP && t.op == ',')
+        {
+            if (expectOperand)
+                return fail(EXPR_SYNTAX_ERROR, "缺少操作数", t.pos);
+            while (optr.peek() != L_P && optr.peek() != EOE)
+                code.push_back({idx2code(optr.pop()), 0, 0});
+            if (optr.peek() != L_P || callee.peek() < 0)
+                return fail(EXPR_SYNTAX_ERROR, "逗号只能分隔函数参数", t.pos);
+            nargs.push(nargs.pop() + 1);
+            expectOperand = true;
+            continue;
+        }
+        // 3. 运算符（含结束符）：先按位置检查，再按优先级归约
+        int cur = t.type == TK_END ? EOE : op2idx(t.op);
+        bool empty = false; // 无参数的函数调用"f()"
+        if (expectOperand)
+        {
+            if (cur == SUB)
+                cur = NEG;
+            else if (cur == R_P && optr.peek() == L_P && callee.peek() >= 0 && nargs.peek() == 0)
+                empty = true;
+            else if (cur != L_P)
+                return fail(EXPR_SYNTAX_ERROR, cur == EOE ? "表达式不完整" : "缺少操作数", t.pos);
+        }
+        else if (cur == L_P)
+            return fail(EXPR_SYNTAX_ERROR, "缺少运算符", t.pos);
+
+        while (pri[optr.peek()][cur] == '>')
+            code.push_back({idx2code(optr.pop()), 0, 0});
+        char rel = pri[optr.peek()][cur];
+        if (rel == '<')
+        {
+            optr.push(cur);
+            if (cur == L_P)
+            {
+                callee.push(-1);
+                nargs.push(0);
+            }
+            expectOperand = cur != FAC;
+        }
+        else if (rel == '=')
+        {
+            optr.pop();
+            if (cur == EOE)
+                break;
+            int id = callee.pop(); // ')'：若匹配的是函数的'('则输出调用
+            int n = nargs.pop() + (empty ? 0 : 1);
+            if (id >= 0)
+            {
+                if (n != registry.arity(id))
+                    return fail(EXPR_SYNTAX_ERROR, "参数个数错误", t.pos);
+                code.push_back({OP_FUNC, id, 0});
+            }
+            expectOperand = false;
+        }
+        else
+            return fail(EXPR_SYNTAX_ERROR, "括号不匹配", t.pos);
+    }
+    ce.computeDepth();
+    return ExprResult{EXPR_OK, 0, nullptr, 0};
+}
+
+ExprResult tryCompile(string_view expr, CompiledExpr &ce, const vector<string> &vars = vector<string>())
+{
+    ParseStacks ps;
+    return tryCompile(expr, ce, vars, ps);
+}
+
+/* 编译表达式，vars给出变量名及其在求值参数中的顺序；出错时抛出const char*错误信息，需要出错位置时用tryCompile */
+CompiledExpr compile(string_view expr, const vector<string> &vars = vector<string>())
+{
+    CompiledExpr ce;
+    ExprResult r = tryCompile(expr, ce, vars);
+    if (!r.ok())
+        throw r.msg;
+    return ce;
+}
+
+/* 表达式求值：编译后立即求值 */
+double evaluate(string_view expr)
+{
+    return compile(expr).eval();
+}
+
+/* 不抛异常的表达式求值 */
+ExprResult tryEvaluate(string_view expr)
+{
+    CompiledExpr ce;
+    ExprResult r = tryCompile(expr, ce);
+    return r.ok() ? ce.tryEval() : r;
+}
+
+/* ---------- 编译表达式的优化：常量折叠、公共子表达式消除、代数化简、幂的强度削减 ---------- */
+
+// 把后缀指令还原为表达式DAG，建图时逐个节点化简，相同的子表达式合并为同一节点，最后重新生成指令
+class ExprOptimizer
+{
+private:
+    struct Node
+    {
+        OpCode op;
+        int arg;
+        double val;
+        int a, b;     // 子节点下标，无则为-1
+        bool mayFail; // 子树中含有可能报错的运算（除法、阶乘、函数），不能因化简而消去
+    };
+
+    vector<Node> nodes;
+    map<tuple<int, int, unsigned long long, int, int>, int> table; // 节点内容 -> 下标，用于合并相同子表达式
+
+    vector<int> refs; // 生成指令时每个节点被引用的次数
+    vector<int> slot; // 已存入临时变量的节点对应的临时变量下标
+    int nTemps;
+
+    int make(OpCode op, int arg, double val, int a, int b)
+    {
+        unsigned long long bits;
+        memcpy(&bits, &val, 8);
+        auto key = make_tuple((int)op, arg, bits, a, b);
+        bool shared = op != OP_FUNC || registry.pure(arg); // 非纯函数的每次调用都要保留
+        auto it = table.find(key);
+        if (shared && it != table.end())
+            return it->second;
+        bool fail = op == OP_DIV || op == OP_FAC || op == OP_FUNC ||
+                    (a >= 0 && nodes[a].mayFail) || (b >= 0 && nodes[b].mayFail);
+        nodes.push_back({op, arg, val, a, b, fail});
+        if (shared)
+            table[key] = nodes.size() - 1;
+        return nodes.size() - 1;
+    }
+
+    int constant(double v)
+    {
+        return make(OP_CONST, 0, v, -1, -1);
+    }
+
+    bool isConst(int n, double v) const
+    {
+        return nodes[n].op == OP_CONST && nodes[n].val == v;
+    }
+
+    // 常数参数上执行一次运算，出错时抛出异常（此时不折叠，保留到运行时报错）
+    static double fold(OpCode op, int arg, double x, double y)
+    {
+        switch (op)
+        {
+        case OP_ADD:
+            return calc(x, '+', y);
+        case OP_SUB:
+            return calc(x, '-', y);
+        case OP_MUL:
+            return calc(x, '*', y);
+        case OP_DIV:
+            return calc(x, '/', y);
+        case OP_POW:
+            return calc(x, '^', y);
+        case OP_FAC:
+            return calc(x, '!');
+        case OP_NEG:
+            return -x;
+        case OP_FUNC:
+        {
+            if (!registry.pure(arg))
+                throw "非纯函数";
+            double args[2] = {x, y};
+            return registry.call(arg, args);
+        }
+        default:
+            throw "非法运算符";
+        }
+    }
+
+    // x^k（k>=2）按二进制拆成乘法，平方项经CSE复用
+    int powInt(int x, int k)
+    {
+        int result = -1, base = x;
+        while (k > 0)
+        {
+            if (k & 1)
+                result = result < 0 ? base : simplify(OP_MUL, 0, result, base);
+            k >>= 1;
+            if (k > 0)
+                base = simplify(OP_MUL, 0, base, base);
+        }
+        return result;
+    }
+
+    int simplify(OpCode op, int arg, int a, int b)
+    {
+        bool ca = a >= 0 && nodes[a].op == OP_CONST, cb = b >= 0 && nodes[b].op == OP_CONST;
+        // 1. 常量折叠（包括阶乘和常数参数的纯函数调用）
+        if ((a < 0 || ca) && (b < 0 || cb))
+        {
+            try
+            {
+                return constant(fold(op, arg, a >= 0 ? nodes[a].val : 0, b >= 0 ? nodes[b].val : 0));
+            }
+            catch (const char *)
+            {
+            }
+        }
+        // 2. 代数化简与幂的强度削减
+        switch (op)
+        {
+        case OP_ADD:
+            if (isConst(a, 0))
+                return b;
+            if (isConst(b, 0))
+                return a;
+            break;
+        case OP_SUB:
+        case OP_DIV:
+            if (isConst(b, op == OP_SUB ? 0 : 1))
+                return a;
+            break;
+        case OP_MUL:
+            if (isConst(a, 1))
+                return b;
+            if (isConst(b, 1))
+                return a;
+            break;
+        case OP_POW:
+            if (cb)
+            {
+                double e = nodes[b].val;
+                if (e == 0 && !nodes[a].mayFail) // pow(x, 0)恒为1
+                    return constant(1);
+                if (e == 1)
+                    return a;
+                if (e >= 2 && e <= 16 && e == floor(e))
+                    return powInt(a, (int)e);
+            }
+            break;
+        case OP_NEG:
+            if (nodes[a].op == OP_NEG) // -(-x) = x
+                return nodes[a].a;
+            break;
+        default:
+            break;
+        }
+        // 加法、乘法可交换，规范子节点顺序后相同的子表达式才能合并
+        if ((op == OP_ADD || op == OP_MUL) && a > b)
+            swap(a, b);
+        return make(op, arg, 0, a, b);
+    }
+
+    // 统计从root可达的每个节点被引用的次数；子节点下标总小于父节点，从root向下扫一遍即可，不需要递归
+    void countRefs(int root)
+    {
+        refs[root] = 1;
+        for (int n = root; n >= 0; n--)
+        {
+            if (refs[n] == 0)
+                continue;
+            if (nodes[n].a >= 0)
+                refs[nodes[n].a]++;
+            if (nodes[n].b >= 0)
+                refs[nodes[n].b]++;
+        }
+    }
+
+    // 后序输出指令：被多次引用的内部节点第一次计算后存入临时变量，之后直接读取
+    // 用显式栈代替递归（记录每个节点已处理的子节点数），深层嵌套的表达式也不会耗尽调用栈
+    void emit(int root, vector<Instr> &code)
+    {
+        vector<pair<int, int>> st;
+        st.push_back({root, 0});
+        while (!st.empty())
+        {
+            int n = st.back().first;
+            const Node &nd = nodes[n];
+            if (st.back().second == 0)
+            {
+                if (nd.op == OP_CONST || nd.op == OP_VAR)
+                {
+                    code.push_back({nd.op, nd.arg, nd.val});
+                    st.pop_back();
+                    continue;
+                }
+                if (slot[n] >= 0)
+                {
+                    code.push_back({OP_LOAD, slot[n], 0});
+                    st.pop_back();
+                    continue;
+                }
+            }
+            int k = st.back().second++;
+            if (k < 2)
+            {
+                int child = k == 0 ? nd.a : nd.b;
+                if (child >= 0)
+                    st.push_back({child, 0});
+                continue;
+            }
+            code.push_back({nd.op, nd.arg, 0});
+            if (refs[n] > 1)
+            {
+                slot[n] = nTemps++;
+                code.push_back({OP_STORE, slot[n], 0});
+            }
+            st.pop_back();
+        }
+    }
+
+public:
+    int nodeCount; // 优化后DAG中可达的节点数
+
+    CompiledExpr run(const CompiledExpr &ce)
+    {
+        // 节点最多两个子节点，含更多参数的函数调用时不做优化
+        for (const Instr &in : ce.code)
+            if (in.op == OP_FUNC && registry.arity(in.arg) > 2)
+            {
+                nodeCount = 0;
+                return ce;
+            }
+        nodes.clear();
+        table.clear();
+        vector<int> st;
+        map<int, int> temps; // 输入中已有的临时变量
+        for (const Instr &in : ce.code)
+        {
+            switch (in.op)
+            {
+            case OP_CONST:
+                st.push_back(constant(in.val));
+                break;
+            case OP_VAR:
+                st.push_back(make(OP_VAR, in.arg, 0, -1, -1));
+                break;
+            case OP_STORE:
+                temps[in.arg] = st.back();
+                break;
+            case OP_LOAD:
+                st.push_back(temps[in.arg]);
+                break;
+            case OP_FAC:
+            case OP_NEG:
+                st.back() = simplify(in.op, in.arg, st.back(), -1);
+                break;
+            case OP_FUNC:
+            {
+                // DAG节点最多两个子节点：0~2个参数的调用
+                int k = registry.arity(in.arg);
+                int b = k == 2 ? st.back() : -1;
+                if (k == 2)
+                    st.pop_back();
+                if (k == 0)
+                    st.push_back(simplify(in.op, in.arg, -1, -1));
+                else
+                    st.back() = simplify(in.op, in.arg, st.back(), b);
+                break;
+            }
+            default:
+            {
+                int b = st.back();
+                st.pop_back();
+                st.back() = simplify(in.op, 0, st.back(), b);
+                break;
+            }
+            }
+        }
+
+        CompiledExpr out;
+        out.vars = ce.vars;
+        int root = st.back();
+        refs.assign(nodes.size(), 0);
+        slot.assign(nodes.size(), -1);
+        nTemps = 0;
+        countRefs(root);
+        nodeCount = 0;
+        for (int r : refs)
+            nodeCount += r > 0;
+        emit(root, out.code);
+        out.nTemps = nTemps;
+        out.computeDepth();
+        return out;
+    }
+};
+
+// 优化编译后的表达式，返回新的指令序列
+CompiledExpr optimize(const CompiledExpr &ce)
+{
+    ExprOptimizer opt;
+    return opt.run(ce);
+}
+
+/* ---------- x86-64 JIT：把字节码翻译为SSE2机器码 ---------- */
+
+// JIT调用的函数包装：机器码中不能抛异常，出错时返回NaN，由外层退回解释器报告错误
+double jitFactorial(double a)
+{
+    return (int)a < 0 ? NAN : factorial((int)a);
+}
+double jitSin(double a) { return sin(a); }
+double jitCos(double a) { return cos(a); }
+double jitTan(double a) { return tan(a); }
+double jitLog(double a) { return a > 0 ? log10(a) : NAN; }
+double jitLn(double a) { return a > 0 ? log(a) : NAN; }
+double jitSqrt(double a) { return a >= 0 ? sqrt(a) : NAN; }
+double jitPow(double a, double b) { return pow(a, b); }
+
+double (*const jitFuncs[F_SQRT + 1])(double) = {jitSin, jitCos, jitTan, jitLog, jitLn, jitSqrt};
+
+// 其余函数经注册表调用，参数依次存放在栈空间中
+double jitCallFunc(const double *args, int id)
+{
+    const char *err = nullptr;
+    double r = registry.call(id, args, err);
+    return err != nullptr ? NAN : r;
+}
+
+// JIT编译的表达式：栈顶值保存在xmm0，其余栈元素保存在调用者提供的栈空间中
+// 寄存器约定：rbx指向变量数组，rbp指向栈空间（均为被调用者保存寄存器，调用libm时不会被破坏）
+class JitExpr
+{
+private:
+    typedef double (*JitFn)(const double *x, double *stack);
+
+    CompiledExpr prog; // 解释器版本，用于出错时重新求值以及不支持JIT的平台
+    JitFn fn;
+    void *mem;
+    size_t memSize;
+    vector<unsigned char> buf;       // 生成中的机器码
+    vector<size_t> errJumps;         // 跳往出错处理的rel32位置，最后统一回填
+
+    void emit(initializer_list<unsigned char> bytes)
+    {
+        buf.insert(buf.end(), bytes);
+    }
+
+    void emit32(unsigned v)
+    {
+        for (int i = 0; i < 4; ++i)
+            buf.push_back((v >> (8 * i)) & 0xff);
+    }
+
+    void emit64(unsigned long long v)
+    {
+        for (int i = 0; i < 8; ++i)
+            buf.push_back((v >> (8 * i)) & 0xff);
+    }
+
+    // mov rax, imm64
+    void emitMovRax(unsigned long long v)
+    {
+        emit({0x48, 0xB8});
+        emit64(v);
+    }
+
+    void emitCall(const void *f)
+    {
+        emitMovRax((unsigned long long)(size_t)f);
+        emit({0xFF, 0xD0}); // call rax
+    }
+
+    // 条件跳转到出错处理：0F cc rel32
+    void emitJccErr(unsigned char cc)
+    {
+        emit({0x0F, cc});
+        errJumps.push_back(buf.size());
+        emit32(0);
+    }
+
+    // 栈中第i个元素的内存位置 [rbp + 8*i]
+    void emitSlot(unsigned char prefix, unsigned char op, int i)
+    {
+        emit({prefix, 0x0F, op, 0x85});
+        emit32(8 * i);
+    }
+
+    void generate()
+    {
+        // 序言：保存rbx/rbp，并保持调用libm时栈按16字节对齐（Win64还需32字节影子空间）
+#ifdef _WIN32
+        emit({0x53, 0x55, 0x48, 0x83, 0xEC, 0x28}); // push rbx; push rbp; sub rsp, 40
+        emit({0x48, 0x89, 0xCB, 0x48, 0x89, 0xD5}); // mov rbx, rcx; mov rbp, rdx
+#else
+        emit({0x53, 0x55, 0x48, 0x83, 0xEC, 0x08}); // push rbx; push rbp; sub rsp, 8
+        emit({0x48, 0x89, 0xFB, 0x48, 0x89, 0xF5}); // mov rbx, rdi; mov rbp, rsi
+#endif
+        int d = 0; // 当前栈深度，栈顶在xmm0，第0..d-2个元素在内存中
+        for (const Instr &in : prog.code)
+        {
+            switch (in.op)
+            {
+            case OP_CONST:
+            case OP_VAR:
+            case OP_LOAD:
+                if (d >= 1)
+                    emitSlot(0xF2, 0x11, d - 1); // movsd [rbp+8*(d-1)], xmm0
+                if (in.op == OP_LOAD)
+                {
+                    emitSlot(0xF2, 0x10, prog.maxDepth + in.arg); // movsd xmm0, [临时变量]
+                }
+                else if (in.op == OP_CONST)
+                {
+                    unsigned long long bits;
+                    memcpy(&bits, &in.val, 8);
+                    emitMovRax(bits);
+                    emit({0x66, 0x48, 0x0F, 0x6E, 0xC0}); // movq xmm0, rax
+                }
+                else
+                {
+                    emit({0xF2, 0x0F, 0x10, 0x83}); // movsd xmm0, [rbx+8*arg]
+                    emit32(8 * in.arg);
+                }
+                d++;
+                break;
+            case OP_ADD:
+                emitSlot(0xF2, 0x58, d - 2); // addsd xmm0, [a]
+                d--;
+                break;
+            case OP_MUL:
+                emitSlot(0xF2, 0x59, d - 2); // mulsd xmm0, [a]
+                d--;
+                break;
+            case OP_SUB:
+            case OP_DIV:
+            case OP_POW:
+                emit({0x66, 0x0F, 0x28, 0xC8}); // movapd xmm1, xmm0（b）
+                if (in.op == OP_DIV)
+                {
+                    // |b| < 1e-12 时出错：去掉符号位后按整数比较
+                    double eps = 1e-12;
+                    unsigned long long epsBits;
+                    memcpy(&epsBits, &eps, 8);
+                    emit({0x66, 0x48, 0x0F, 0x7E, 0xC8}); // movq rax, xmm1
+                    emit({0x48, 0xD1, 0xE0});             // shl rax, 1
+                    emit({0x48, 0xB9});                   // mov rcx, imm64
+                    emit64(epsBits << 1);
+                    emit({0x48, 0x39, 0xC8}); // cmp rax, rcx
+                    emitJccErr(0x82);         // jb error
+                }
+                emitSlot(0xF2, 0x10, d - 2); // movsd xmm0, [a]
+                if (in.op == OP_SUB)
+                    emit({0xF2, 0x0F, 0x5C, 0xC1}); // subsd xmm0, xmm1
+                else if (in.op == OP_DIV)
+                    emit({0xF2, 0x0F, 0x5E, 0xC1}); // divsd xmm0, xmm1
+                else
+                    emitCall((const void *)jitPow);
+                d--;
+                break;
+            case OP_NEG:
+                emitMovRax(0x8000000000000000ULL);
+                emit({0x66, 0x48, 0x0F, 0x6E, 0xC8}); // movq xmm1, rax
+                emit({0x66, 0x0F, 0x57, 0xC1});       // xorpd xmm0, xmm1（翻转符号位）
+                break;
+            case OP_FAC:
+            case OP_FUNC:
+                if (in.op == OP_FUNC && in.arg > F_SQRT)
+                {
+                    // 栈顶写回内存，全部参数即在[rbp+8*(d-k)]起连续存放
+                    int k = registry.arity(in.arg);
+                    if (d >= 1)
+                        emitSlot(0xF2, 0x11, d - 1);
+#ifdef _WIN32
+                    emit({0x48, 0x8D, 0x8D}); // lea rcx, [rbp+8*(d-k)]
+                    emit32(8 * (d - k));
+                    emit({0xBA}); // mov edx, id
+#else
+                    emit({0x48, 0x8D, 0xBD}); // lea rdi, [rbp+8*(d-k)]
+                    emit32(8 * (d - k));
+                    emit({0xBE}); // mov esi, id
+#endif
+                    emit32(in.arg);
+                    emitCall((const void *)jitCallFunc);
+                    d -= k - 1;
+                }
+                else
+                    emitCall(in.op == OP_FAC ? (const void *)jitFactorial : (const void *)jitFuncs[in.arg]);
+                emit({0x66, 0x0F, 0x2E, 0xC0}); // ucomisd xmm0, xmm0
+                emitJccErr(0x8A);               // jp error（结果为NaN）
+                break;
+            case OP_STORE:
+                emitSlot(0xF2, 0x11, prog.maxDepth + in.arg); // movsd [临时变量], xmm0
+                break;
+            }
+        }
+        emit({0xE9}); // jmp epilogue
+        size_t jmpPos = buf.size();
+        emit32(0);
+
+        // 出错处理：返回NaN
+        size_t errPos = buf.size();
+        emitMovRax(0x7ff8000000000000ULL);
+        emit({0x66, 0x48, 0x0F, 0x6E, 0xC0}); // movq xmm0, rax
+
+        size_t epiPos = buf.size();
+#ifdef _WIN32
+        emit({0x48, 0x83, 0xC4, 0x28}); // add rsp, 40
+#else
+        emit({0x48, 0x83, 0xC4, 0x08}); // add rsp, 8
+#endif
+        emit({0x5D, 0x5B, 0xC3}); // pop rbp; pop rbx; ret
+
+        auto patch = [this](size_t at, size_t target)
+        {
+            unsigned rel = (unsigned)(target - (at + 4));
+            memcpy(&buf[at], &rel, 4);
+        };
+        patch(jmpPos, epiPos);
+        for (size_t at : errJumps)
+            patch(at, errPos);
+    }
+
+public:
+    JitExpr(const CompiledExpr &ce) : prog(ce), fn(nullptr), mem(nullptr), memSize(0)
+    {
+#ifdef EXPR_JIT
+        generate();
+        memSize = buf.size();
+#ifdef _WIN32
+        mem = VirtualAlloc(nullptr, memSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (mem == nullptr)
+            return;
+        memcpy(mem, buf.data(), memSize);
+        DWORD old;
+        if (!VirtualProtect(mem, memSize, PAGE_EXECUTE_READ, &old))
+            return;
+#else
+        mem = mmap(nullptr, memSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED)
+        {
+            mem = nullptr;
+            return;
+        }
+        memcpy(mem, buf.data(), memSize);
+        if (mprotect(mem, memSize, PROT_READ | PROT_EXEC) != 0) // 写入后改为只读可执行
+            return;
+#endif
+        fn = (JitFn)mem;
+#endif
+    }
+
+    ~JitExpr()
+    {
+#ifdef EXPR_JIT
+        if (mem != nullptr)
+        {
+#ifdef _WIN32
+            VirtualFree(mem, 0, MEM_RELEASE);
+#else
+            munmap(mem, memSize);
+#endif
+        }
+#endif
+    }
+
+    JitExpr(const JitExpr &) = delete;
+    JitExpr &operator=(const JitExpr &) = delete;
+
+    bool isNative() const
+    {
+        return fn != nullptr;
+    }
+
+    size_t codeSize() const
+    {
+        return buf.size();
+    }
+
+    double eval(const double *x = nullptr) const
+    {
+        if (fn == nullptr)
+            return prog.eval(x);
+        double r;
+        if (prog.frameSize() <= 64)
+        {
+            double st[64];
+            r = fn(x, st);
+        }
+        else
+        {
+            vector<double> st(prog.frameSize());
+            r = fn(x, st.data());
+        }
+        // NaN可能来自除零或定义域错误，交给解释器给出一致的结果或异常
+        if (r != r)
+            return prog.eval(x);
+        return r;
+    }
+};
+
+/* ---------- 批量文件求值：分块读入，多线程求值，按输入顺序输出 ---------- */
+
+// 分片LRU缓存：表达式文本 -> 编译结果（编译失败也缓存）；每个分片独立加锁，减少线程间竞争
+class CompileCache
+{
+public:
+    struct Entry
+    {
+        CompiledExpr ce;
+        ExprResult status;
+    };
+
+    explicit CompileCache(size_t capacity, int nShards = 16)
+        : shards(nShards), perShard(max<size_t>(1, capacity / nShards)), nHits(0), nMisses(0) {}
+
+    // 查找，未命中时用调用者的编译栈编译后插入；编译在锁外进行，长公式不会阻塞同一分片的其他线程
+    shared_ptr<const Entry> get(string_view text, ParseStacks &ps)
+    {
+        Shard &sh = shards[hash<string_view>()(text) % shards.size()];
+        {
+            lock_guard<mutex> lock(sh.m);
+            auto it = sh.index.find(text);
+            if (it != sh.index.end())
+            {
+                sh.order.splice(sh.order.begin(), sh.order, it->second); // 移到最近使用端
+                nHits++;
+                return it->second->second;
+            }
+        }
+        auto e = make_shared<Entry>();
+        e->status = tryCompile(text, e->ce, vector<string>(), ps);
+        nMisses++;
+
+        lock_guard<mutex> lock(sh.m);
+        auto it = sh.index.find(text);
+        if (it != sh.index.end()) // 其他线程已经插入
+            return it->second->second;
+        sh.order.emplace_front(string(text), e);
+        sh.index[sh.order.front().first] = sh.order.begin(); // 键指向链表结点中的字符串，结点地址不变
+        if (sh.order.size() > perShard)
+        {
+            sh.index.erase(sh.order.back().first);
+            sh.order.pop_back();
+        }
+        return e;
+    }
+
+    size_t hits() const
+    {
+        return nHits;
+    }
+
+    size_t misses() const
+    {
+        return nMisses;
+    }
+
+private:
+    typedef list<pair<string, shared_ptr<const Entry>>> Order;
+
+    struct Shard
+    {
+        mutex m;
+        Order order; // 按最近使用排序，表头最新
+        unordered_map<string_view, Order::iterator> index;
+    };
+
+    vector<Shard> shards;
+    size_t perShard;
+    atomic<size_t> nHits, nMisses;
+};
+
+struct BatchStats
+{
+    size_t lines;
+    size_t errors;
+    double seconds;
+    size_t cacheHits;
+};
+
+/* 批量求值：in中每行一个表达式，out中对应行输出结果或错误
+   主线程按大块读入并在行边界切分为任务，工作线程各用自己的求值栈计算整块，
+   写线程通过重排缓冲区按任务序号顺序输出；在途任务数有上限，内存占用与文件大小无关
+   nThreads不足1时按1个工作线程处理 */
+BatchStats batchEvaluate(FILE *in, FILE *out, int nThreads, size_t cacheSize = 4096)
+{
+    nThreads = max(1, nThreads);
+    const size_t BLOCK = 1 << 18;       // 每次读入的字节数
+    const size_t WINDOW = 4 * nThreads; // 已读入但未输出的任务数上限
+
+    CompileCache cache(cacheSize);
+    mutex m;
+    condition_variable cv;
+    deque<pair<size_t, string>> queue; // 待求值的任务（序号，若干完整行）
+    map<size_t, string> done;          // 重排缓冲区：已完成但尚未轮到输出的任务
+    size_t nRead = 0, nWritten = 0;
+    bool eof = false;
+    atomic<size_t> nLines(0), nErrors(0);
+    auto wall0 = chrono::steady_clock::now();
+
+    auto worker = [&]()
+    {
+        vector<double> stack(64); // 本线程的求值栈，按需增长
+        ParseStacks ps;           // 本线程的编译栈
+        size_t lines = 0, errors = 0;
+        char buf[128];
+        for (;;)
+        {
+            pair<size_t, string> job;
+            {
+                unique_lock<mutex> lock(m);
+                cv.wait(lock, [&] { return !queue.empty() || eof; });
+                if (queue.empty())
+                    break;
+                job = move(queue.front());
+                queue.pop_front();
+            }
+            string result;
+            string_view text = job.second;
+            while (!text.empty())
+            {
+                size_t nl = text.find('\n');
+                string_view line = text.substr(0, nl);
+                text = nl == string_view::npos ? string_view() : text.substr(nl + 1);
+                if (!line.empty() && line.back() == '\r')
+                    line.remove_suffix(1);
+                lines++;
+                if (line.empty())
+                {
+                    result += '\n';
+                    continue;
+                }
+                shared_ptr<const CompileCache::Entry> e = cache.get(line, ps);
+                const char *err = e->status.msg;
+                size_t pos = e->status.pos;
+                double v = 0;
+                if (e->status.ok())
+                {
+                    if ((size_t)e->ce.frameSize() > stack.size())
+                        stack.resize(e->ce.frameSize());
+                    err = e->ce.exec<double>(nullptr, stack.data(), v);
+                    pos = ExprResult::NO_POS;
+                }
+                if (err == nullptr)
+                    snprintf(buf, sizeof(buf), "%.15g\n", v);
+                else if (pos == ExprResult::NO_POS)
+                    snprintf(buf, sizeof(buf), "错误: %s\n", err);
+                else
+                    snprintf(buf, sizeof(buf), "错误: %s（位置 %zu）\n", err, pos);
+                errors += err != nullptr;
+                result += buf;
+            }
+            lock_guard<mutex> lock(m);
+            done[job.first] = move(result);
+            cv.notify_all();
+        }
+        nLines += lines;
+        nErrors += errors;
+    };
+
+    auto writer = [&]()
+    {
+        unique_lock<mutex> lock(m);
+        for (;;)
+        {
+            cv.wait(lock, [&] { return done.count(nWritten) || (eof && nWritten == nRead); });
+            if (!done.count(nWritten))
+                break;
+            string s = move(done[nWritten]);
+            done.erase(nWritten);
+            lock.unlock();
+            fwrite(s.data(), 1, s.size(), out);
+            lock.lock();
+            nWritten++;
+            cv.notify_all();
+        }
+    };
+
+    vector<thread> pool;
+    for (int i = 0; i < nThreads; ++i)
+        pool.emplace_back(worker);
+    thread wt(writer);
+
+    // 读入：每块在最后一个换行处切开，剩余部分并入下一块
+    string carry;
+    vector<char> block(BLOCK);
+    for (;;)
+    {
+        size_t n = fread(block.data(), 1, BLOCK, in);
+        string chunk = move(carry);
+        chunk.append(block.data(), n);
+        carry.clear();
+        if (n > 0)
+        {
+            size_t last = chunk.rfind('\n');
+            if (last == string::npos)
+            {
+                carry = move(chunk);
+                continue;
+            }
+            carry.assign(chunk, last + 1, string::npos);
+            chunk.resize(last + 1);
+        }
+        unique_lock<mutex> lock(m);
+        if (!chunk.empty())
+        {
+            cv.wait(lock, [&] { return nRead - nWritten < WINDOW; });
+            queue.emplace_back(nRead++, move(chunk));
+        }
+        if (n == 0)
+            eof = true;
+        cv.notify_all();
+        if (eof)
+            break;
+    }
+    for (thread &t : pool)
+        t.join();
+    wt.join();
+    fflush(out);
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - wall0).count();
+    return BatchStats{nLines, nErrors, seconds, cache.hits()};
+}
+
+/* ---------- 命名单元格：公式之间的依赖图与增量重算 ---------- */
+
+// 公式中的名字（后面不跟'('的标识符）即引用的单元格；修改单元格后只重算受影响的单元格，
+// 按拓扑层次逐层计算，同一层内互不依赖，较大的层分给多个线程；无法排入拓扑序的单元格处于循环引用中
+class Sheet
+{
+public:
+    struct RecalcStats
     {
-        if (line.empty())
+        size_t cells;  // 本次重算的单元格数
+        int levels;    // 拓扑层数
+        size_t cyclic; // 处于循环引用（或依赖循环）的单元格数
+    };
+
+    size_t totalRecomputed; // 累计重算的单元格数
+
+    explicit Sheet(int threads = 1) : totalRecomputed(0), epoch(0), nThreads(max(1, threads)) {}
+
+    // 设置单元格公式，重算推迟到recalc()
+    void set(const string &name, string_view formula)
+    {
+        int c = cellId(name);
+        Cell &cell = cells[c];
+        cell.defined = true;
+
+        vector<string> refs;
+        Tokenizer lex(formula);
+        for (Token t = lex.next(); t.type != TK_END && t.type != TK_BAD; t = lex.next())
+            if (t.type == TK_IDENT && !lex.nextIs('(') && find(refs.begin(), refs.end(), t.name) == refs.end())
+                refs.emplace_back(t.name);
+        cell.parse = tryCompile(formula, cell.ce, refs);
+
+        vector<int> deps;
+        if (cell.parse.ok())
+            for (const string &r : refs)
+                deps.push_back(cellId(r));
+        setDeps(c, deps);
+        pending.push_back(c);
+    }
+
+    // 设置为常数
+    void set(const string &name, double v)
+    {
+        int c = cellId(name);
+        Cell &cell = cells[c];
+        cell.defined = true;
+        cell.parse = ExprResult{EXPR_OK, 0, nullptr, 0};
+        cell.ce = CompiledExpr();
+        cell.ce.code.push_back({OP_CONST, 0, v});
+        cell.ce.computeDepth();
+        setDeps(c, vector<int>());
+        pending.push_back(c);
+    }
+
+    // 重算所有被修改的单元格及其（传递）引用者
+    RecalcStats recalc()
+    {
+        RecalcStats st = {0, 0, 0};
+        epoch++;
+        // 1. 脏集合：从被修改的单元格沿反向边广度优先搜索
+        vector<int> dirty;
+        for (int c : pending)
+            if (stamp[c] != epoch)
+            {
+                stamp[c] = epoch;
+                dirty.push_back(c);
+            }
+        pending.clear();
+        for (size_t i = 0; i < dirty.size(); ++i)
+            for (int u : cells[dirty[i]].users)
+                if (stamp[u] != epoch)
+                {
+                    stamp[u] = epoch;
+                    dirty.push_back(u);
+                }
+        // 2. 脏集合内按入度逐层计算（Kahn算法）
+        vector<int> level;
+        for (int c : dirty)
+        {
+            indeg[c] = 0;
+            for (int d : cells[c].deps)
+                indeg[c] += stamp[d] == epoch;
+            if (indeg[c] == 0)
+                level.push_back(c);
+        }
+        while (!level.empty())
+        {
+            evalLevel(level);
+            st.cells += level.size();
+            st.levels++;
+            vector<int> next;
+            for (int c : level)
+                for (int u : cells[c].users)
+                    if (--indeg[u] == 0)
+                        next.push_back(u);
+            level.swap(next);
+        }
+        // 3. 剩余的单元格在环上或依赖环
+        for (int c : dirty)
+            if (indeg[c] > 0)
+            {
+                cells[c].res = ExprResult{EXPR_MATH_ERROR, ExprResult::NO_POS, "循环引用", NAN};
+                st.cyclic++;
+            }
+        totalRecomputed += st.cells;
+        return st;
+    }
+
+    // 单元格的值或错误
+    ExprResult get(const string &name) const
+    {
+        auto it = index.find(name);
+        if (it == index.end())
+            return ExprResult{EXPR_NAME_ERROR, ExprResult::NO_POS, "未定义单元格", NAN};
+        return cells[it->second].res;
+    }
+
+    size_t size() const
+    {
+        return cells.size();
+    }
+
+private:
+    struct Cell
+    {
+        bool defined;      // 仅被引用、尚未设置公式的单元格为false
+        CompiledExpr ce;   // 变量i对应deps[i]
+        ExprResult parse;  // 编译结果
+        ExprResult res;    // 当前值或错误
+        vector<int> deps;  // 引用的单元格
+        vector<int> users; // 引用本单元格的单元格
+    };
+
+    vector<Cell> cells;
+    unordered_map<string, int> index;
+    vector<int> pending;    // 已修改、等待重算的单元格
+    vector<unsigned> stamp; // stamp[c]==epoch表示c属于本次重算的脏集合
+    vector<int> indeg;      // 脏集合内尚未计算的引用数
+    unsigned epoch;
+    int nThreads;
+
+    int cellId(const string &name)
+    {
+        auto it = index.find(name);
+        if (it != index.end())
+            return it->second;
+        Cell cell;
+        cell.defined = false;
+        cell.parse = ExprResult{EXPR_OK, 0, nullptr, 0};
+        cell.res = ExprResult{EXPR_NAME_ERROR, ExprResult::NO_POS, "未定义单元格", NAN};
+        cells.push_back(move(cell));
+        stamp.push_back(0);
+        indeg.push_back(0);
+        index[name] = cells.size() - 1;
+        return cells.size() - 1;
+    }
+
+    // 更新依赖边：从旧引用的users中删除，再加入新引用的users
+    void setDeps(int c, const vector<int> &deps)
+    {
+        for (int d : cells[c].deps)
+        {
+            vector<int> &u = cells[d].users;
+            auto it = find(u.begin(), u.end(), c);
+            *it = u.back();
+            u.pop_back();
+        }
+        cells[c].deps = deps;
+        for (int d : deps)
+            cells[d].users.push_back(c);
+    }
+
+    void evalRange(const vector<int> &level, size_t lo, size_t hi)
+    {
+        vector<double> x, stack;
+        for (size_t i = lo; i < hi; ++i)
+        {
+            Cell &cell = cells[level[i]];
+            if (!cell.defined)
+                continue;
+            if (!cell.parse.ok())
+            {
+                cell.res = cell.parse;
+                continue;
+            }
+            x.resize(cell.deps.size());
+            const char *err = nullptr;
+            for (size_t k = 0; k < cell.deps.size() && err == nullptr; ++k)
+            {
+                const ExprResult &d = cells[cell.deps[k]].res;
+                if (!d.ok())
+                    err = "引用的单元格有错误";
+                x[k] = d.value;
+            }
+            if (stack.size() < (size_t)cell.ce.frameSize())
+                stack.resize(cell.ce.frameSize());
+            if (err == nullptr)
+                err = cell.ce.exec(x.data(), stack.data(), cell.res.value);
+            cell.res.status = err == nullptr ? EXPR_OK : EXPR_MATH_ERROR;
+            cell.res.msg = err;
+            cell.res.pos = ExprResult::NO_POS;
+        }
+    }
+
+    // 同一层内的单元格互不依赖，层较大时分段并行
+    void evalLevel(const vector<int> &level)
+    {
+        const size_t GRAIN = 4096;
+        int nt = (int)min<size_t>(nThreads, level.size() / GRAIN);
+        if (nt <= 1)
+        {
+            evalRange(level, 0, level.size());
+            return;
+        }
+        vector<thread> pool;
+        for (int t = 0; t < nt; ++t)
+            pool.emplace_back([&, t]()
+                              { evalRange(level, level.size() * t / nt, level.size() * (t + 1) / nt); });
+        for (thread &th : pool)
+            th.join();
+    }
+};
+
+/* 编译求值测试：带变量的公式，以及编译一次重复求值与逐次解析的速度对比 */
+void testCompiled()
+{
+    CompiledExpr f = compile("x^2 + 2*x*y + sin(y) - ln(x)", {"x", "y"});
+    double xy[2] = {3, 0.5};
+    cout << "编译表达式：x^2 + 2*x*y + sin(y) - ln(x)，共" << f.code.size() << "条指令" << endl;
+    cout << "x=3, y=0.5 时结果 = " << f.eval(xy)
+         << "（直接求值：" << evaluate("3^2 + 2*3*0.5 + sin(0.5) - ln(3)") << "）" << endl;
+
+    const char *formulas[] = {"sqrt(16) * 2 + 1", "1 + 2*(3+4)/5 - 6", "tan(3.14159265/4) + log(100)", "5! - 2^3"};
+    const int ROUNDS = 100000;
+    for (const char *e : formulas)
+    {
+        double r1 = 0, r2 = 0;
+        clock_t start = clock();
+        for (int k = 0; k < ROUNDS; ++k)
+            r1 += evaluate(e);
+        double t1 = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        CompiledExpr ce = compile(e);
+        start = clock();
+        for (int k = 0; k < ROUNDS; ++k)
+            r2 += ce.eval();
+        double t2 = (double)(clock() - start) / CLOCKS_PER_SEC;
+        cout << e << "：逐次解析 " << ROUNDS / t1 << " 次/秒，编译后求值 " << ROUNDS / t2 << " 次/秒"
+             << (r1 == r2 ? "" : "（结果不一致）") << endl;
+    }
+    cout << "-------------------------" << endl;
+}
+
+/* 列式批量求值测试：对百万行数据逐行求值与按块求值的速度对比 */
+void testBatch()
+{
+    const size_t ROWS = 1000000;
+    vector<double> xs(ROWS), ys(ROWS), out(ROWS);
+    for (size_t i = 0; i < ROWS; ++i)
+    {
+        xs[i] = 0.5 + (double)(i % 1000) / 100;
+        ys[i] = 1.0 + (double)(i % 777) / 50;
+    }
+    const double *cols[2] = {xs.data(), ys.data()};
+
+    const char *formulas[] = {"x*x + 3*x*y - y/2 + sqrt(x*x + y*y)", "sin(x)*cos(y) + ln(x + 1)"};
+    for (const char *e : formulas)
+    {
+        CompiledExpr f = compile(e, {"x", "y"});
+        clock_t start = clock();
+        double sum = 0;
+        for (size_t i = 0; i < ROWS; ++i)
+        {
+            double xy[2] = {xs[i], ys[i]};
+            sum += f.eval(xy);
+        }
+        double t1 = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        start = clock();
+        f.evalBatch(cols, ROWS, out.data());
+        double t2 = (double)(clock() - start) / CLOCKS_PER_SEC;
+        double maxErr = 0;
+        for (size_t i = 0; i < ROWS; i += 997)
+        {
+            double xy[2] = {xs[i], ys[i]};
+            maxErr = max(maxErr, fabs(out[i] - f.eval(xy)));
+        }
+        cout << e << "：逐行 " << ROWS / t1 / 1e6 << " 百万行/秒，按块 " << ROWS / t2 / 1e6 << " 百万行/秒"
+             << "（最大误差 " << maxErr << "）" << endl;
+
+        vector<double> fast(ROWS);
+        start = clock();
+        f.evalBatch(cols, ROWS, fast.data(), true);
+        double t3 = (double)(clock() - start) / CLOCKS_PER_SEC;
+        double fastErr = 0;
+        for (size_t i = 0; i < ROWS; ++i)
+            fastErr = max(fastErr, fabs(fast[i] - out[i]));
+        cout << "    近似函数按块 " << ROWS / t3 / 1e6 << " 百万行/秒（与精确结果最大误差 " << fastErr << "）" << endl;
+    }
+    cout << "-------------------------" << endl;
+}
+
+/* JIT测试：公式集上对比逐次解析（evaluate）、字节码解释器和JIT机器码 */
+void testJit()
+{
+    const char *corpus[] = {
+        "x*x + 3*x*y - y/2",
+        "sqrt(x*x + y*y) / (1 + x)",
+        "sin(x)*cos(y) + ln(x + 1)",
+        "(x - 1)*(x + 1)*(y - 2)*(y + 2) / (x*y + 1)",
+        "x^3 - 2*x^2 + y^0.5 - 7",
+        "-x*-y + -(x - 1)^2",
+        "1 + x/2 + x*x/6 + x*x*x/24 - tan(y/10)"};
+    const int ROUNDS = 200000;
+    double vals[2] = {1.5, 2.5};
+    for (const char *e : corpus)
+    {
+        // evaluate没有变量，把x、y替换为数值后每次重新解析
+        string lit;
+        for (const char *p = e; *p; ++p)
+        {
+            if (*p == 'x')
+                lit += "(1.5)";
+            else if (*p == 'y')
+                lit += "(2.5)";
+            else
+                lit += *p;
+        }
+        CompiledExpr ce = compile(e, {"x", "y"});
+        JitExpr je(ce);
+
+        double r0 = 0, r1 = 0, r2 = 0;
+        clock_t start = clock();
+        for (int k = 0; k < ROUNDS / 20; ++k)
+            r0 = evaluate(lit);
+        double t0 = (double)(clock() - start) / CLOCKS_PER_SEC * 20;
+        start = clock();
+        for (int k = 0; k < ROUNDS; ++k)
+        {
+            vals[0] = 1.5 + (k & 1) * 1e-9;
+            r1 = ce.eval(vals);
+        }
+        double t1 = (double)(clock() - start) / CLOCKS_PER_SEC;
+        start = clock();
+        for (int k = 0; k < ROUNDS; ++k)
+        {
+            vals[0] = 1.5 + (k & 1) * 1e-9;
+            r2 = je.eval(vals);
+        }
+        double t2 = (double)(clock() - start) / CLOCKS_PER_SEC;
+        bool same = fabs(r0 - r1) < 1e-6 && fabs(r1 - r2) < 1e-6;
+        cout << e << "：evaluate " << ROUNDS / t0 / 1e6 << "，解释器 " << ROUNDS / t1 / 1e6
+             << "，JIT " << ROUNDS / t2 / 1e6 << "（百万次/秒）" << (same ? "" : "（结果不一致）") << endl;
+    }
+    JitExpr bad(compile("1/(x-1)", {"x"}));
+    double one = 1;
+    try
+    {
+        bad.eval(&one);
+        cout << "JIT除零未报错" << endl;
+    }
+    catch (const char *e)
+    {
+        cout << "JIT 1/(x-1)，x=1：" << e << (bad.isNative() ? "（机器码检测后退回解释器）" : "（解释器）") << endl;
+    }
+    cout << "-------------------------" << endl;
+}
+
+/* 优化测试：比较优化前后的指令数与结果 */
+void testOptimizer()
+{
+    const char *formulas[] = {
+        "sqrt(16) * 2 + 1",
+        "2^3 + 5! - ln(1)",
+        "x*1 + 0 + y^2 - x/1",
+        "(x+y)*(x+y) + sin(x+y)",
+        "x^5 + x^4 + x^8",
+        "-(-x) * -y + -(2 - 3)",
+        "(x*y + 1)/(x*y + 1) + ln(x*y + 1)"};
+    double xy[2] = {1.25, 0.75};
+    for (const char *e : formulas)
+    {
+        CompiledExpr ce = compile(e, {"x", "y"});
+        ExprOptimizer opt;
+        CompiledExpr oe = opt.run(ce);
+        JitExpr je(oe);
+        double r1 = ce.eval(xy), r2 = oe.eval(xy), r3 = je.eval(xy);
+        bool same = fabs(r1 - r2) <= 1e-12 * max(1.0, fabs(r1)) && fabs(r2 - r3) <= 1e-12 * max(1.0, fabs(r2));
+        cout << e << "：指令 " << ce.code.size() << " -> " << oe.code.size() << "，节点 " << opt.nodeCount
+             << "，临时变量 " << oe.nTemps << "，结果 " << r2 << (same ? "" : "（结果不一致）") << endl;
+    }
+
+    // 深层嵌套：sin(x + sin(x + ...))，优化器的引用计数和指令生成都不递归
+    const int DEPTH = 100000;
+    string deep;
+    for (int k = 0; k < DEPTH; ++k)
+        deep += "sin(x + ";
+    deep += "y";
+    deep += string(DEPTH, ')');
+    CompiledExpr ce = compile(deep, {"x", "y"});
+    ExprOptimizer opt;
+    CompiledExpr oe = opt.run(ce);
+    double r1 = ce.eval(xy), r2 = oe.eval(xy);
+    cout << "嵌套 " << DEPTH << " 层：指令 " << ce.code.size() << " -> " << oe.code.size() << "，结果 " << r2
+         << (r1 == r2 ? "" : "（结果不一致）") << endl;
+    cout << "-------------------------" << endl;
+}
+
+/* 机器生成公式：随机嵌套的四则运算、函数调用和负号 */
+void genFormula(string &out, unsigned &seed, int depth)
+{
+    static const char *ops[] = {" + ", " - ", " * ", " / "};
+    seed = seed * 1103515245 + 12345;
+    unsigned r = seed >> 16;
+    if (depth == 0 || r % 8 == 0)
+    {
+        out += to_string(r % 1000);
+        if (r & 1)
+            out += ".25";
+        return;
+    }
+    switch (r % 4)
+    {
+    case 0:
+        out += r / 4 % 2 ? "sin" : "cos";
+        out += '(';
+        genFormula(out, seed, depth - 1);
+        out += ')';
+        break;
+    case 1:
+        out += "-(";
+        genFormula(out, seed, depth - 1);
+        out += ')';
+        break;
+    default:
+        out += '(';
+        genFormula(out, seed, depth - 1);
+        out += ops[r / 4 % 4];
+        genFormula(out, seed, depth - 1);
+        out += ')';
+    }
+}
+
+/* 解析吞吐量测试：长公式只编译不求值 */
+void testParse()
+{
+    vector<string> formulas;
+    size_t bytes = 0;
+    unsigned seed = 2025;
+    while (formulas.size() < 200)
+    {
+        string f;
+        genFormula(f, seed, 14);
+        if (f.size() < 1000)
+            continue;
+        bytes += f.size();
+        formulas.push_back(f);
+    }
+
+    const int ROUNDS = 20;
+    size_t instrs = 0;
+    clock_t start = clock();
+    for (int k = 0; k < ROUNDS; ++k)
+        for (const string &f : formulas)
+            instrs += compile(f).code.size();
+    double t = (double)(clock() - start) / CLOCKS_PER_SEC;
+    double n = (double)ROUNDS * formulas.size();
+    cout << "解析" << formulas.size() << "个机器生成公式（平均" << bytes / formulas.size() << "字节，"
+         << instrs / (size_t)n << "条指令）：" << n / t << " 个/秒，" << n * bytes / formulas.size() / t / 1e6 << " MB/秒" << endl;
+
+    // 复用同一组编译栈
+    ParseStacks ps;
+    CompiledExpr ce;
+    start = clock();
+    for (int k = 0; k < ROUNDS; ++k)
+        for (const string &f : formulas)
+            tryCompile(f, ce, vector<string>(), ps);
+    t = (double)(clock() - start) / CLOCKS_PER_SEC;
+    cout << "复用编译栈：" << n / t << " 个/秒" << endl;
+
+    // 深层嵌套：栈超出内部存储后自动扩容
+    const int DEPTH = 10000;
+    string deep;
+    for (int k = 0; k < DEPTH; ++k)
+        deep += k % 2 ? "(1 + " : "-(";
+    deep += "1";
+    deep.append(DEPTH, ')');
+    try
+    {
+        cout << "嵌套" << DEPTH << "层：结果 = " << evaluate(deep) << endl;
+    }
+    catch (const char *e)
+    {
+        cout << "嵌套" << DEPTH << "层：错误: " << e << endl;
+    }
+    cout << "-------------------------" << endl;
+}
+
+/* 错误处理开销测试：一半公式无效时，异常接口与返回状态接口的吞吐量对比 */
+void testErrors()
+{
+    vector<string> corpus;
+    unsigned seed = 38;
+    for (int k = 0; k < 20000; ++k)
+    {
+        string f;
+        genFormula(f, seed, 4);
+        switch (k % 6) // 一半无效：非法字符、括号不匹配、除零
+        {
+        case 1:
+            f.insert(f.size() / 2, "$");
+            break;
+        case 3:
+            f = "(" + f;
+            break;
+        case 5:
+            f += " / (1 - 1)";
             break;
+        }
+        corpus.push_back(f);
+    }
+
+    const int ROUNDS = 5;
+    int bad1 = 0, bad2 = 0;
+    clock_t start = clock();
+    for (int r = 0; r < ROUNDS; ++r)
+        for (const string &f : corpus)
+        {
+            try
+            {
+                evaluate(f);
+            }
+            catch (const char *)
+            {
+                bad1++;
+            }
+        }
+    double t1 = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    for (int r = 0; r < ROUNDS; ++r)
+        for (const string &f : corpus)
+            bad2 += !tryEvaluate(f).ok();
+    double t2 = (double)(clock() - start) / CLOCKS_PER_SEC;
+    double n = (double)ROUNDS * corpus.size();
+    cout << "50%无效公式（" << bad1 / ROUNDS << "/" << corpus.size() << "）：异常接口 " << n / t1
+         << " 个/秒，返回状态接口 " << n / t2 << " 个/秒" << (bad1 == bad2 ? "" : "（结果不一致）") << endl;
+    cout << "-------------------------" << endl;
+}
+
+/* 用户注册函数测试：多参数、无参数的非纯函数，以及解释器、JIT与优化器的一致性 */
+double fnClamp(const double *a, const char *&)
+{
+    return a[0] < a[1] ? a[1] : (a[0] > a[2] ? a[2] : a[0]);
+}
+
+int tickCount = 0;
+double fnTick(const double *, const char *&)
+{
+    return ++tickCount;
+}
+
+void testFunctions()
+{
+    registry.add("clamp", 3, fnClamp);
+    registry.add("tick", 0, fnTick, false);
+
+    const char *formulas[] = {"max(x, y) + atan2(y, x) * clamp(x*10, 0, 5)",
+                              "hypot(x, y)",
+                              "min(2, 3) * x + abs(-y) + exp(0)",
+                              "tick() + tick() - floor(x)"};
+    double xs[3] = {0.2, 1.5, -3}, ys[3] = {1, -2, 0.5};
+    for (const char *e : formulas)
+    {
+        cout << e << "：";
         try
         {
-            cout << "结果 = " << evaluate(line) << endl;
+            CompiledExpr ce = compile(e, {"x", "y"});
+            CompiledExpr oe = optimize(ce);
+            JitExpr je(ce);
+            for (int i = 0; i < 3; ++i)
+            {
+                double xy[2] = {xs[i], ys[i]};
+                tickCount = 0;
+                double r = ce.eval(xy);
+                tickCount = 0;
+                double rj = je.eval(xy);
+                tickCount = 0;
+                double ro = oe.eval(xy);
+                cout << r << (r == rj && r == ro ? "" : "（结果不一致）") << " ";
+            }
+            cout << "（指令 " << ce.code.size() << " -> " << oe.code.size() << "）" << endl;
         }
         catch (const char *e)
         {
             cout << "错误: " << e << endl;
         }
+    }
+    cout << "-------------------------" << endl;
+}
+
+/* 批量文件求值测试：生成含重复行和无效行的表达式文件，比较不同线程数的吞吐量，并检查输出与单线程一致 */
+void testBatchFile()
+{
+    const int DISTINCT = 5000, LINES = 200000;
+    vector<string> pool;
+    unsigned seed = 39;
+    for (int k = 0; k < DISTINCT; ++k)
+    {
+        string f;
+        genFormula(f, seed, 5);
+        if (k % 10 == 0)
+            f += ")"; // 10%无效
+        pool.push_back(f);
+    }
+    FILE *in = tmpfile();
+    if (in == nullptr)
+    {
+        cout << "无法创建临时文件" << endl;
+        return;
+    }
+    for (int k = 0; k < LINES; ++k)
+    {
+        // 偏斜分布：约一半的行来自前1%的公式
+        seed = seed * 1103515245 + 12345;
+        unsigned r = seed >> 8;
+        const string &f = pool[r & 1 ? r % (DISTINCT / 100) : r % DISTINCT];
+        fputs(f.c_str(), in);
+        fputc('\n', in);
+    }
+
+    string first;
+    int maxThreads = max(4, (int)thread::hardware_concurrency());
+    for (int t = 1; t <= maxThreads; t *= 2)
+    {
+        rewind(in);
+        FILE *out = tmpfile();
+        if (out == nullptr)
+            break;
+        BatchStats st = batchEvaluate(in, out, t, 1024);
+        string res;
+        char buf[65536];
+        size_t n;
+        rewind(out);
+        while ((n = fread(buf, 1, sizeof(buf), out)) > 0)
+            res.append(buf, n);
+        fclose(out);
+        if (t == 1)
+            first = res;
+        cout << "批量求值 " << t << " 线程：" << st.lines / st.seconds << " 行/秒，出错 " << st.errors
+             << " 行，缓存命中率 " << 100.0 * st.cacheHits / st.lines << "%" << (res == first ? "" : "（输出不一致）") << endl;
+    }
+    fclose(in);
+    cout << "-------------------------" << endl;
+}
+
+/* 单元格增量重算测试：W列L层的网格，每个单元格引用上一层相邻的两个单元格，修改一个输入只影响一个三角形区域 */
+void testSheet()
+{
+    const int W = 1000, L = 200;
+    auto name = [](int l, int j)
+    {
+        return "c" + to_string(l) + "_" + to_string(j);
+    };
+    Sheet sheet(max(1, (int)thread::hardware_concurrency()));
+    clock_t start = clock();
+    for (int j = 0; j < W; ++j)
+        sheet.set(name(0, j), (double)j);
+    for (int l = 1; l < L; ++l)
+        for (int j = 0; j < W; ++j)
+            sheet.set(name(l, j), name(l - 1, j) + " * 0.5 + " + name(l - 1, (j + 1) % W) + " * 0.5");
+    double tBuild = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    Sheet::RecalcStats full = sheet.recalc();
+    double tFull = (double)(clock() - start) / CLOCKS_PER_SEC;
+    cout << "单元格 " << sheet.size() << " 个：建立 " << tBuild << " 秒，全部计算 " << full.cells << " 个（" << full.levels
+         << " 层）" << tFull << " 秒，" << name(L - 1, 0) << " = " << sheet.get(name(L - 1, 0)).value << endl;
+
+    start = clock();
+    sheet.set(name(0, 500), 1000.0);
+    Sheet::RecalcStats one = sheet.recalc();
+    double tOne = (double)(clock() - start) / CLOCKS_PER_SEC;
+    cout << "修改 " << name(0, 500) << "：重算 " << one.cells << " 个，" << tOne << " 秒，" << name(L - 1, 400)
+         << " = " << sheet.get(name(L - 1, 400)).value << "，累计重算 " << sheet.totalRecomputed << " 个" << endl;
+
+    // 循环引用：检测后报错，打破循环后恢复
+    Sheet s2;
+    s2.set("a", "b + 1");
+    s2.set("b", "a * 2");
+    s2.set("c", "max(a, 10)");
+    Sheet::RecalcStats cyc = s2.recalc();
+    ExprResult rc = s2.get("c");
+    cout << "a = b + 1, b = a * 2, c = max(a, 10)：循环 " << cyc.cyclic << " 个，c：" << (rc.ok() ? "正常" : rc.msg) << endl;
+    s2.set("b", "3");
+    Sheet::RecalcStats fix = s2.recalc();
+    cout << "改为 b = 3：重算 " << fix.cells << " 个，a = " << s2.get("a").value << "，c = " << s2.get("c").value << endl;
+    s2.set("d", "undefinedCell + 1");
+    s2.recalc();
+    cout << "d = undefinedCell + 1：" << s2.get("d").msg << endl;
+    cout << "-------------------------" << endl;
+}
+
+/* 对偶数与区间求值测试：梯度与有限差分对比，以及区间估计 */
+void testDual()
+{
+    CompiledExpr f = compile("x^3 - 2*x*y + sin(y)/x + max(x, y)", {"x", "y"});
+    double xy[2] = {1.5, 0.7}, grad[2];
+    double v = f.gradient(xy, grad);
+    // 解析导数：df/dx = 3x^2 - 2y - sin(y)/x^2 + 1，df/dy = -2x + cos(y)/x
+    double gx = 3 * 1.5 * 1.5 - 2 * 0.7 - sin(0.7) / (1.5 * 1.5) + 1, gy = -2 * 1.5 + cos(0.7) / 1.5;
+    cout << "x^3 - 2*x*y + sin(y)/x + max(x, y) 在(1.5, 0.7)：值 " << v << "，梯度 (" << grad[0] << ", " << grad[1]
+         << ")，与解析导数之差 " << max(fabs(grad[0] - gx), fabs(grad[1] - gy)) << endl;
+
+    const int ROUNDS = 200000;
+    double err1 = 0, err2 = 0;
+    clock_t start = clock();
+    for (int k = 0; k < ROUNDS; ++k)
+    {
+        xy[0] = 1.5 + k * 1e-7;
+        f.gradient(xy, grad);
+        gx = 3 * xy[0] * xy[0] - 2 * 0.7 - sin(0.7) / (xy[0] * xy[0]) + 1;
+        err1 = max(err1, fabs(grad[0] - gx));
+    }
+    double t1 = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    for (int k = 0; k < ROUNDS; ++k)
+    {
+        // 中心差分：每个变量两次求值
+        xy[0] = 1.5 + k * 1e-7;
+        for (int i = 0; i < 2; ++i)
+        {
+            double h = 1e-6, p[2] = {xy[0], xy[1]}, m[2] = {xy[0], xy[1]};
+            p[i] += h;
+            m[i] -= h;
+            grad[i] = (f.eval(p) - f.eval(m)) / (2 * h);
+        }
+        gx = 3 * xy[0] * xy[0] - 2 * 0.7 - sin(0.7) / (xy[0] * xy[0]) + 1;
+        err2 = max(err2, fabs(grad[0] - gx));
+    }
+    double t2 = (double)(clock() - start) / CLOCKS_PER_SEC;
+    cout << "梯度：对偶数 " << ROUNDS / t1 / 1e6 << " 百万次/秒（最大误差 " << err1 << "），中心差分 "
+         << ROUNDS / t2 / 1e6 << " 百万次/秒（最大误差 " << err2 << "）" << endl;
+
+    registry.add("smoothstep", 1, [](const double *a, const char *&) { return a[0] * a[0] * (3 - 2 * a[0]); });
+    CompiledExpr g = compile("smoothstep(x) * 2", {"x"});
+    double x0 = 0.25, dg;
+    g.gradient(&x0, &dg);
+    cout << "用户函数 smoothstep(x) * 2 在0.25处的导数（差分近似）：" << dg << "（精确值 " << 2 * 6 * 0.25 * 0.75 << "）" << endl;
+
+    const char *ranges[] = {"x^2 - 2*x + 1", "sin(x) * y", "exp(-x) / y + abs(x - 1)", "sqrt(x - 1)"};
+    Interval box[2] = {Interval(0, 2), Interval(1, 2)};
+    for (const char *e : ranges)
+    {
+        cout << e << "，x∈[0, 2]，y∈[1, 2]：";
+        try
+        {
+            Interval r = compile(e, {"x", "y"}).evalAs(box);
+            cout << "[" << r.lo << ", " << r.hi << "]" << endl;
+        }
+        catch (const char *msg)
+        {
+            cout << "错误: " << msg << endl;
+        }
+    }
+    cout << "-------------------------" << endl;
+}
+
+/* 测试函数 */
+int main(int argc, char *argv[])
+{
+    // 批量模式：--batch 输入文件 输出文件 [线程数]
+    if (argc >= 4 && strcmp(argv[1], "--batch") == 0)
+    {
+        FILE *in = fopen(argv[2], "rb");
+        FILE *out = fopen(argv[3], "wb");
+        if (in == nullptr || out == nullptr)
+        {
+            cerr << "无法打开文件" << endl;
+            return 1;
+        }
+        int nThreads = argc >= 5 ? atoi(argv[4]) : (int)thread::hardware_concurrency();
+        BatchStats st = batchEvaluate(in, out, nThreads);
+        fclose(in);
+        fclose(out);
+        cerr << st.lines << " 行，出错 " << st.errors << " 行，用时 " << st.seconds << " 秒，"
+             << st.lines / st.seconds << " 行/秒，缓存命中 " << st.cacheHits << " 次" << endl;
+        return 0;
+    }
+    // 测试用例（覆盖基础运算、函数、负号、阶乘、全角）
+    const char *tests[] = {
+        "1 + 2 * 3",         // 基础运算
+        "(1 + 2) * 3",       // 括号
+        "3.5 / 2 + 1",       // 小数
+        "sin(0) + cos(0)",   // 三角函数
+        "ln(2.718281828)",   // 自然对数
+        "sqrt(16) * 2 + 1",  // 平方根
+        "1 + 2*(3+4)/5 - 6", // 混合运算
+        "tan(3.14159265/4)", // 正切（π/4≈0.785）
+        "log(100)",          // 常用对数
+        "-1 + 2",            // 负号（开头）
+        "1 + (-2)",          // 负号（括号内）
+        "5!",                // 阶乘
+        "2^3",               // 幂运算
+        "１＋２×３",         // 全角运算符
+        "2 * -3",            // 负号（运算符后）
+        "-2^2",              // 负号优先级低于幂
+        "sqrt(sin(1)^2 + cos(1)^2)", // 嵌套函数调用
+        "max(1, 2) + atan2(1, 1) * 4", // 多参数函数
+        "1 + + 2",           // 非法表达式（连续+）
+        "(1 + 2) * ",        // 非法表达式（缺少操作数）
+        "sin(1",             // 非法表达式（括号不匹配）
+        "max(1)",            // 非法表达式（参数个数错误）
+        "3 $ 4",             // 非法字符
+        "5 / 0"              // 除零错误
+    };
+
+    int n = sizeof(tests) / sizeof(tests[0]);
+    for (int i = 0; i < n; ++i)
+    {
+        cout << "表达式：" << tests[i] << endl;
+        try
+        {
+            cout << "结果 = " << evaluate(tests[i]) << endl;
+        }
+        catch (const char *e)
+        {
+            cout << "错误: " << e << " => 式子无效" << endl;
+        }
+        cout << "-------------------------" << endl;
+    }
+
+    testCompiled();
+    testBatch();
+    testJit();
+    testOptimizer();
+    testParse();
+    testFunctions();
+    testErrors();
+    testBatchFile();
+    testSheet();
+    testDual();
+
+    /* 交互模式（空行退出） */
+    cout << "请输入表达式（空行退出）：" << endl;
+    string line;
+    while (getline(cin, line))
+    {
+        if (line.empty())
+            break;
+        ExprResult r = tryEvaluate(line);
+        if (r.ok())
+            cout << "结果 = " << r.value << endl;
+        else
+        {
+            cout << "错误: " << r.msg << endl;
+            if (r.pos != ExprResult::NO_POS)
+                cout << line.substr(0, r.pos) << " <<< 此处" << endl;
+        }
         cout << "-------------------------" << endl;
     }
 
@@ -1,38 +1,1082 @@
 #include <iostream>
 #include <vector>
-#include <stack>
 #include <algorithm>
 #include <cstdlib>
 #include <ctime>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+#include <filesystem>
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 using namespace std;
-/* 计算柱状图中最大矩形面积（单调栈） */
-int largestRectangleArea(vector<int> &heights)
+/* 计算柱状图中最大矩形面积（单调栈）
+   不修改输入，末尾按高度0的哨兵处理；下标和面积用64位整数，柱子很多时不溢出
+   stk为调用者提供的栈（存放下标），多次调用时可重复使用已分配的空间 */
+long long largestRectangleArea(const int *heights, size_t n, vector<size_t> &stk)
 {
-    heights.push_back(0); // 哨兵，保证栈最后能清空
-    stack<int> stk;       // 存放下标
-    int maxArea = 0;
-    for (int i = 0; i < (int)heights.size(); ++i)
+    stk.clear();
+    long long maxArea = 0;
+    for (size_t i = 0; i <= n; ++i)
     {
-        while (!stk.empty() && heights[stk.top()] > heights[i])
+        int cur = i < n ? heights[i] : 0;
+        while (!stk.empty() && heights[stk.back()] > cur)
         {
-            int h = heights[stk.top()];
-            stk.pop();
-            int left = stk.empty() ? -1 : stk.top();
-            int w = i - left - 1;
+            long long h = heights[stk.back()];
+            stk.pop_back();
+            long long left = stk.empty() ? -1 : (long long)stk.back();
+            long long w = (long long)i - left - 1;
             maxArea = max(maxArea, h * w);
         }
-        stk.push(i);
+        stk.push_back(i);
     }
-    heights.pop_back(); // 恢复原始数组
     return maxArea;
 }
+
+long long largestRectangleArea(const int *heights, size_t n)
+{
+    vector<size_t> stk;
+    return largestRectangleArea(heights, n, stk);
+}
+
+long long largestRectangleArea(const vector<int> &heights)
+{
+    return largestRectangleArea(heights.data(), heights.size());
+}
+
+/* 流式计算：高度逐块输入，只保存单调栈而不保存整个数组
+   栈中每项记录高度和它能向左延伸到的起点，高度严格递增，栈长不超过不同高度值的个数 */
+class RectangleStream
+{
+public:
+    RectangleStream() : n(0), best(0) {}
+
+    void push(int h)
+    {
+        long long start = n;
+        while (!stk.empty() && stk.back().height >= h)
+        {
+            const Bar &b = stk.back();
+            best = max(best, (long long)b.height * (n - b.start));
+            start = b.start;
+            stk.pop_back();
+        }
+        stk.push_back({h, start});
+        n++;
+    }
+
+    void push(const int *h, size_t cnt)
+    {
+        for (size_t i = 0; i < cnt; ++i)
+            push(h[i]);
+    }
+
+    // 到目前为止输入的所有柱子中的最大矩形面积（不影响后续输入）
+    long long result() const
+    {
+        long long r = best;
+        for (const Bar &b : stk)
+            r = max(r, (long long)b.height * (n - b.start));
+        return r;
+    }
+
+    long long count() const
+    {
+        return n;
+    }
+
+    size_t stackSize() const
+    {
+        return stk.size();
+    }
+
+private:
+    struct Bar
+    {
+        int height;
+        long long start;
+    };
+
+    vector<Bar> stk;
+    long long n;    // 已输入的柱子数
+    long long best; // 已出栈的柱子中的最大面积
+};
+
+/* 从二进制文件（连续的int）分块读入，内存占用为一块缓冲区加单调栈 */
+long long largestRectangleFromFile(FILE *f, long long *count = NULL)
+{
+    const size_t BLOCK = 1 << 16;
+    vector<int> buf(BLOCK);
+    RectangleStream rs;
+    size_t got;
+    while ((got = fread(buf.data(), sizeof(int), BLOCK, f)) > 0)
+        rs.push(buf.data(), got);
+    if (count != NULL)
+        *count = rs.count();
+    return rs.result();
+}
+
+/* ---------- 大文件输入：内存映射 + 向量化整数扫描，直接送入流式单调栈 ---------- */
+
+// 从p开始第一个数字字符的位置，没有则返回end；SSE2下每次判断16个字节
+inline const char *skipToDigit(const char *p, const char *end)
+{
+#ifdef __SSE2__
+    for (; p + 16 <= end; p += 16)
+    {
+        __m128i d = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)p), _mm_set1_epi8('0'));
+        __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(d, _mm_set1_epi8(-1)), _mm_cmplt_epi8(d, _mm_set1_epi8(10)));
+        unsigned m = (unsigned)_mm_movemask_epi8(isDigit);
+        if (m != 0)
+            return p + __builtin_ctz(m);
+    }
+#endif
+    while (p < end && (unsigned)(*p - '0') >= 10)
+        p++;
+    return p;
+}
+
+// 从p开始第一个非数字字符的位置
+inline const char *skipDigits(const char *p, const char *end)
+{
+#ifdef __SSE2__
+    for (; p + 16 <= end; p += 16)
+    {
+        __m128i d = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)p), _mm_set1_epi8('0'));
+        __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(d, _mm_set1_epi8(-1)), _mm_cmplt_epi8(d, _mm_set1_epi8(10)));
+        unsigned m = ~(unsigned)_mm_movemask_epi8(isDigit) & 0xffff;
+        if (m != 0)
+            return p + __builtin_ctz(m);
+    }
+#endif
+    while (p < end && (unsigned)(*p - '0') < 10)
+        p++;
+    return p;
+}
+
+/* 解析[begin, end)中的十进制整数：任何非数字字符都是分隔符，紧挨数字前的'-'表示负数，超出int范围的取int的上下限
+   每凑满一批调用 sink(const int *, size_t)；final为false时末尾可能被截断的数不解析，返回它的起始位置供下次接上 */
+template <class Sink>
+const char *scanIntegers(const char *begin, const char *end, bool final, Sink &&sink)
+{
+    const size_t BATCH = 4096;
+    int buf[BATCH];
+    size_t cnt = 0;
+    const char *p = begin, *rest = end;
+    for (;;)
+    {
+        p = skipToDigit(p, end);
+        bool neg = p > begin && p[-1] == '-';
+        if (p == end)
+        {
+            if (!final && neg)
+                rest = end - 1;
+            break;
+        }
+        const char *q = skipDigits(p, end);
+        if (q == end && !final)
+        {
+            rest = neg ? p - 1 : p;
+            break;
+        }
+        long long v = 0;
+        for (const char *c = p; c < q; ++c)
+            if (v <= INT_MAX)
+                v = v * 10 + (*c - '0');
+        v = neg ? max(-v, (long long)INT_MIN) : min(v, (long long)INT_MAX);
+        buf[cnt++] = (int)v;
+        if (cnt == BATCH)
+        {
+            sink(buf, cnt);
+            cnt = 0;
+        }
+        p = q;
+    }
+    if (cnt > 0)
+        sink(buf, cnt);
+    return rest;
+}
+
+// 分块读入的版本：块尾未读完的数挪到下一块开头
+template <class Sink>
+void scanIntegers(FILE *f, Sink &&sink, size_t block = 1 << 16)
+{
+    vector<char> buf(block);
+    size_t keep = 0, got;
+    while ((got = fread(buf.data() + keep, 1, buf.size() - keep, f)) > 0)
+    {
+        const char *end = buf.data() + keep + got;
+        const char *rest = scanIntegers(buf.data(), end, false, sink);
+        keep = end - rest;
+        memmove(buf.data(), rest, keep);
+        if (keep == buf.size()) // 一个数比整块还长
+            buf.resize(buf.size() * 2);
+    }
+    scanIntegers(buf.data(), buf.data() + keep, true, sink);
+}
+
+/* 只读映射整个文件；不支持mmap的平台或映射失败时data为NULL，由调用者改为分块读 */
+class MappedFile
+{
+public:
+    explicit MappedFile(const char *path) : data(NULL), size(0)
+    {
+#ifndef _WIN32
+        int fd = open(path, O_RDONLY);
+        struct stat sb;
+        if (fd < 0)
+            return;
+        if (fstat(fd, &sb) == 0 && sb.st_size > 0)
+        {
+            void *p = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                madvise(p, (size_t)sb.st_size, MADV_SEQUENTIAL);
+                data = (const char *)p;
+                size = (size_t)sb.st_size;
+            }
+        }
+        close(fd);
+#else
+        (void)path;
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (data != NULL)
+            munmap((void *)data, size);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data;
+    size_t size;
+};
+
+/* 文本文件中的整数依次作为柱子高度，不保存整个数组；文件打不开时返回-1 */
+long long largestRectangleFromText(const char *path, long long *count = NULL)
+{
+    RectangleStream rs;
+    auto sink = [&rs](const int *v, size_t k)
+    { rs.push(v, k); };
+    MappedFile mf(path);
+    if (mf.data != NULL)
+        scanIntegers(mf.data, mf.data + mf.size, true, sink);
+    else
+    {
+        FILE *f = fopen(path, "rb");
+        if (f == NULL)
+            return -1;
+        scanIntegers(f, sink);
+        fclose(f);
+    }
+    if (count != NULL)
+        *count = rs.count();
+    return rs.result();
+}
+
+/* 二进制文件（连续的int）：映射后直接当作int数组；文件打不开时返回-1 */
+long long largestRectangleFromBinary(const char *path, long long *count = NULL)
+{
+    MappedFile mf(path);
+    if (mf.data == NULL)
+    {
+        FILE *f = fopen(path, "rb");
+        if (f == NULL)
+            return -1;
+        long long area = largestRectangleFromFile(f, count);
+        fclose(f);
+        return area;
+    }
+    RectangleStream rs;
+    rs.push((const int *)mf.data, mf.size / sizeof(int));
+    if (count != NULL)
+        *count = rs.count();
+    return rs.result();
+}
+
+/* 段[lo, hi)内的单调栈：返回段内最大矩形，并留下跨段合并所需的两条包络（下标均为全局下标）
+   pre为严格前缀最小值（位置递增、高度递减），suf为段末未弹出的单调栈，即非严格后缀最小值（位置递增、高度不减） */
+long long segmentRectangle(const int *h, size_t lo, size_t hi, vector<size_t> &pre, vector<size_t> &suf)
+{
+    long long best = 0;
+    for (size_t i = lo; i < hi; ++i)
+    {
+        while (!suf.empty() && h[suf.back()] > h[i])
+        {
+            long long ht = h[suf.back()];
+            suf.pop_back();
+            long long left = suf.empty() ? (long long)lo - 1 : (long long)suf.back();
+            best = max(best, ht * ((long long)i - left - 1));
+        }
+        if (pre.empty() || h[i] < h[pre.back()])
+            pre.push_back(i);
+        suf.push_back(i);
+    }
+    // 段末按高度0的哨兵结算，但不弹栈，栈留给合并阶段
+    for (size_t j = suf.size(); j-- > 0;)
+    {
+        long long left = j > 0 ? (long long)suf[j - 1] : (long long)lo - 1;
+        best = max(best, (long long)h[suf[j]] * ((long long)hi - left - 1));
+    }
+    return best;
+}
+
+/* 并行分治：数组分成T段，各段内用单调栈求最大矩形，同时留下前缀/后缀最小值包络；
+   跨段的最大矩形以某根包络上的柱子为最矮柱，它两侧第一根更矮的柱子也都在包络上：
+   段外一侧在相邻各段的包络上按段最小值跳段、段内二分查找，段内一侧直接取包络上的相邻元素。
+   合并只访问包络而不逐根扫描柱子，单调输入时包络虽长，每根也只做常数次比较，各段仍可并行 */
+long long largestRectangleParallel(const int *h, size_t n, int nThreads)
+{
+    const size_t MIN_PART = 1 << 16; // 每段至少的柱子数
+    int T = (int)min<size_t>(max(nThreads, 1), n / MIN_PART);
+    if (T <= 1)
+        return largestRectangleArea(h, n);
+
+    vector<size_t> cut(T + 1); // 第t段为[cut[t], cut[t+1])
+    for (int t = 0; t <= T; ++t)
+        cut[t] = n * t / T;
+    vector<vector<size_t>> pre(T), suf(T);
+    vector<long long> res(2 * T, 0);
+    vector<thread> pool;
+    for (int t = 0; t < T; ++t)
+        pool.emplace_back([&, t]()
+                          { res[t] = segmentRectangle(h, cut[t], cut[t + 1], pre[t], suf[t]); });
+    for (thread &th : pool)
+        th.join();
+    pool.clear();
+
+    // 从第s段起第一根低于H的柱子，没有时为n；H不增时s只前进，调用方保留s作游标
+    auto firstLess = [&](int &s, long long H) -> long long
+    {
+        while (s < T && h[pre[s].back()] >= H)
+            s++;
+        if (s == T)
+            return (long long)n;
+        return (long long)*partition_point(pre[s].begin(), pre[s].end(), [&](size_t i)
+                                           { return h[i] >= H; });
+    };
+    // 第s段及以前最后一根不高于H的柱子，没有时为-1；H不增时s只后退
+    auto lastNotAbove = [&](int &s, long long H) -> long long
+    {
+        while (s >= 0 && h[suf[s].front()] > H)
+            s--;
+        if (s < 0)
+            return -1;
+        return (long long)*(partition_point(suf[s].begin(), suf[s].end(), [&](size_t i)
+                                            { return h[i] <= H; }) - 1);
+    };
+    for (int t = 0; t < T; ++t)
+        pool.emplace_back([&, t]()
+                          {
+            long long best = 0;
+            const vector<size_t> &p = pre[t], &q = suf[t];
+            // 后缀最小值：右侧更矮的柱子在后面的段里，左侧不高于它的柱子是栈中下一个，栈底则到前面的段里找
+            int sr = t + 1;
+            for (size_t j = q.size(); j-- > 0;)
+            {
+                long long H = h[q[j]];
+                long long right = firstLess(sr, H);
+                int s = t - 1;
+                long long left = j > 0 ? (long long)q[j - 1] : lastNotAbove(s, H);
+                best = max(best, H * (right - left - 1));
+            }
+            // 前缀最小值：左侧不高于它的柱子在前面的段里，右侧更矮的柱子是包络上的下一个，最后一个则到后面的段里找
+            int sl = t - 1;
+            for (size_t k = 0; k < p.size(); ++k)
+            {
+                long long H = h[p[k]];
+                long long left = lastNotAbove(sl, H);
+                int s = t + 1;
+                long long right = k + 1 < p.size() ? (long long)p[k + 1] : firstLess(s, H);
+                best = max(best, H * (right - left - 1));
+            }
+            res[T + t] = best; });
+    for (thread &th : pool)
+        th.join();
+    return *max_element(res.begin(), res.end());
+}
+
 /* 生成 [l, r] 区间的随机整数 */
 int randInt(int l, int r)
 {
     return l + rand() % (r - l + 1);
 }
-int main()
+/* ---------- 二维：0/1矩阵中全为1的最大矩形 ---------- */
+
+/* 逐行输入矩阵，维护每列向上连续1的个数（高度数组），每行对高度数组调用单调栈核心；
+   行可以是每列一个字节，也可以按位压缩（第j列为 bits[j/64] 的第 j%64 位） */
+class MaximalRectangle
 {
+public:
+    explicit MaximalRectangle(size_t cols) : heights(cols, 0), best(0) {}
+
+    void addRow(const unsigned char *row)
+    {
+        updateHeights(heights.data(), row, heights.size());
+        best = max(best, largestRectangleArea(heights.data(), heights.size(), stk));
+    }
+
+    void addRow(const uint64_t *bits)
+    {
+        updateHeights(heights.data(), bits, heights.size());
+        best = max(best, largestRectangleArea(heights.data(), heights.size(), stk));
+    }
+
+    // 从给定的高度数组继续（用于按行分段并行）
+    void setHeights(const vector<int> &h)
+    {
+        heights = h;
+    }
+
+    const vector<int> &currentHeights() const
+    {
+        return heights;
+    }
+
+    long long result() const
+    {
+        return best;
+    }
+
+    // 高度：为1则加1，为0则清零
+    static void updateHeights(int *h, const unsigned char *row, size_t n)
+    {
+        size_t j = 0;
+#ifdef __AVX2__
+        const __m256i one = _mm256_set1_epi32(1);
+        for (; j + 8 <= n; j += 8)
+        {
+            __m256i r = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(row + j)));
+            __m256i zero = _mm256_cmpeq_epi32(r, _mm256_setzero_si256());
+            __m256i v = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(h + j)), one);
+            _mm256_storeu_si256((__m256i *)(h + j), _mm256_andnot_si256(zero, v));
+        }
+#endif
+        for (; j < n; ++j)
+            h[j] = (h[j] + 1) & -(int)(row[j] != 0);
+    }
+
+    static void updateHeights(int *h, const uint64_t *bits, size_t n)
+    {
+        size_t j = 0;
+#ifdef __AVX2__
+        // 每次取8位，广播后与各通道的位掩码比较得到8个通道的0/1
+        const __m256i sel = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        const __m256i one = _mm256_set1_epi32(1);
+        for (; j + 8 <= n; j += 8)
+        {
+            int byte = (int)(bits[j / 64] >> (j % 64)) & 0xff;
+            __m256i m = _mm256_and_si256(_mm256_set1_epi32(byte), sel);
+            __m256i set = _mm256_cmpeq_epi32(m, sel);
+            __m256i v = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(h + j)), one);
+            _mm256_storeu_si256((__m256i *)(h + j), _mm256_and_si256(set, v));
+        }
+#endif
+        for (; j < n; ++j)
+            h[j] = (h[j] + 1) & -(int)((bits[j / 64] >> (j % 64)) & 1);
+    }
+
+private:
+    vector<int> heights;
+    vector<size_t> stk; // 各行共用的单调栈
+    long long best;
+};
+
+/* 按位压缩矩阵的最大全1矩形，行按带分给多个线程；stride为每行占用的64位字数
+   第一遍各带从全0高度开始只更新高度，得到带末高度；带末高度等于带的行数说明该列整带都是1，
+   于是逐带递推出每个带开始时的真实高度；第二遍各带从该高度开始逐行求最大矩形 */
+long long maximalRectangle(const uint64_t *bits, size_t rows, size_t cols, size_t stride, int nThreads)
+{
+    int T = (int)max<size_t>(1, min<size_t>(max(nThreads, 1), rows / 64));
+    vector<size_t> cut(T + 1);
+    for (int t = 0; t <= T; ++t)
+        cut[t] = rows * t / T;
+
+    vector<vector<int>> init(T, vector<int>(cols, 0)); // 各带开始时的高度
+    vector<thread> pool;
+    if (T > 1)
+    {
+        vector<vector<int>> tail(T, vector<int>(cols, 0));
+        for (int t = 0; t < T - 1; ++t)
+            pool.emplace_back([&, t]()
+                              {
+                for (size_t r = cut[t]; r < cut[t + 1]; ++r)
+                    MaximalRectangle::updateHeights(tail[t].data(), bits + r * stride, cols); });
+        for (thread &th : pool)
+            th.join();
+        pool.clear();
+        for (int t = 1; t < T; ++t)
+        {
+            int bandRows = (int)(cut[t] - cut[t - 1]);
+            for (size_t j = 0; j < cols; ++j)
+                init[t][j] = tail[t - 1][j] == bandRows ? init[t - 1][j] + bandRows : tail[t - 1][j];
+        }
+    }
+
+    vector<long long> res(T, 0);
+    for (int t = 0; t < T; ++t)
+        pool.emplace_back([&, t]()
+                          {
+            MaximalRectangle mr(cols);
+            mr.setHeights(init[t]);
+            for (size_t r = cut[t]; r < cut[t + 1]; ++r)
+                mr.addRow(bits + r * stride);
+            res[t] = mr.result(); });
+    for (thread &th : pool)
+        th.join();
+    return *max_element(res.begin(), res.end());
+}
+
+/* ---------- 区间查询：同一高度数组上多次询问 [l, r] 内的最大矩形 ---------- */
+
+/* 直线 y = a*x + b 的逐点最大值线段树（Li Chao树），x取 0..n-1；插入可限定在一个区间上 */
+class LineMaxTree
+{
+public:
+    explicit LineMaxTree(size_t n) : size(1)
+    {
+        while (size < n)
+            size <<= 1;
+        t.assign(2 * size, Line{0, -1});
+    }
+
+    void reset()
+    {
+        fill(t.begin(), t.end(), Line{0, -1});
+    }
+
+    // 在 x∈[lo, hi] 上插入直线
+    void insert(size_t lo, size_t hi, long long a, long long b)
+    {
+        if (lo <= hi)
+            insert(1, 0, size - 1, lo, hi, Line{a, b});
+    }
+
+    long long query(size_t x) const
+    {
+        long long best = -1;
+        for (size_t node = size + x; node >= 1; node >>= 1)
+            best = max(best, t[node].at(x));
+        return best;
+    }
+
+private:
+    struct Line
+    {
+        long long a, b;
+        long long at(size_t x) const { return a * (long long)x + b; }
+    };
+    size_t size;
+    vector<Line> t;
+
+    void insert(size_t node, size_t nl, size_t nr, size_t lo, size_t hi, Line ln)
+    {
+        if (hi < nl || nr < lo)
+            return;
+        if (lo <= nl && nr <= hi)
+        {
+            // 结点区间被完全覆盖：保留中点处较大的直线，较小的只可能在一侧更大，继续下传
+            for (;;)
+            {
+                size_t mid = (nl + nr) / 2;
+                if (ln.at(mid) > t[node].at(mid))
+                    swap(ln, t[node]);
+                if (nl == nr)
+                    return;
+                if (ln.at(nl) > t[node].at(nl))
+                    node = 2 * node, nr = mid;
+                else if (ln.at(nr) > t[node].at(nr))
+                    node = 2 * node + 1, nl = mid + 1;
+                else
+                    return;
+            }
+        }
+        size_t mid = (nl + nr) / 2;
+        insert(2 * node, nl, mid, lo, hi, ln);
+        insert(2 * node + 1, mid + 1, nr, lo, hi, ln);
+    }
+};
+
+/* 预处理一次，回答任意 [l, r]（闭区间，0起）内的最大矩形
+   对每根柱子k，取它作为最左最小值时的最大范围 [L[k], R[k]]（左边第一个不大于它、右边第一个小于它的柱子之间），
+   这些范围构成笛卡尔树的子树；leftSub[k]、rightSub[k]为k的左、右子树范围内的最大矩形，与之配合的是取区间最小值位置的稀疏表 */
+class RangeRectangle
+{
+public:
+    explicit RangeRectangle(const vector<int> &heights) : h(heights), L(h.size()), R(h.size()), leftSub(h.size()), rightSub(h.size())
+    {
+        size_t n = h.size();
+        // 单调栈一遍求 L、R 和子树答案：柱子出栈时其子树已全部出栈，子树答案沿出栈顺序累积
+        // 入栈时carry为刚出栈的左子树，出栈时carry为刚出栈的右子树
+        vector<size_t> stk;
+        for (size_t i = 0; i <= n; ++i)
+        {
+            long long carry = 0;
+            while (!stk.empty() && (i == n || h[stk.back()] > h[i]))
+            {
+                size_t k = stk.back();
+                stk.pop_back();
+                R[k] = i - 1;
+                rightSub[k] = carry;
+                carry = max(max(leftSub[k], carry), (long long)h[k] * (long long)(R[k] - L[k] + 1));
+            }
+            if (i < n)
+            {
+                L[i] = stk.empty() ? 0 : stk.back() + 1;
+                leftSub[i] = carry;
+                stk.push_back(i);
+            }
+        }
+        // 稀疏表：st[j][i]为 [i, i+2^j) 中最左的最小值位置
+        st.push_back(vector<unsigned>(n));
+        for (size_t i = 0; i < n; ++i)
+            st[0][i] = (unsigned)i;
+        for (size_t j = 1; ((size_t)1 << j) <= n; ++j)
+        {
+            const vector<unsigned> &prev = st[j - 1];
+            size_t half = (size_t)1 << (j - 1);
+            vector<unsigned> cur(n - 2 * half + 1);
+            for (size_t i = 0; i < cur.size(); ++i)
+                cur[i] = h[prev[i + half]] < h[prev[i]] ? prev[i + half] : prev[i];
+            st.push_back(move(cur));
+        }
+    }
+
+    size_t size() const
+    {
+        return h.size();
+    }
+
+    // [l, r]中最左的最小值位置
+    size_t argmin(size_t l, size_t r) const
+    {
+        int j = 63 - __builtin_clzll((unsigned long long)(r - l + 1));
+        size_t a = st[j][l], b = st[j][r + 1 - ((size_t)1 << j)];
+        return h[b] < h[a] ? b : a;
+    }
+
+    /* 单次查询：以区间最小值m切分，左段沿l起的严格前缀最小值链 p -> R[p]+1 走到m，右段沿r起的后缀最小值链 q -> L[q]-1 走到m；
+       链上每根柱子向内一侧的范围被区间截断，另一侧恰为一棵完整子树，直接取预处理的子树答案
+       步数为两条链的长度之和：随机数据上约为 O(log n)；最坏（单调数组）为 r-l，每步只读三个相邻数组元素，
+       不会慢于对区间做一遍单调栈扫描。与数据分布无关的次线性保证见queryBatch */
+    long long query(size_t l, size_t r) const
+    {
+        size_t m = argmin(l, r);
+        long long best = (long long)h[m] * (long long)(r - l + 1);
+        for (size_t p = l; p < m; p = R[p] + 1) // [l, R[p]]都不低于h[p]，右子树 [p+1, R[p]] 在区间内
+            best = max(best, max(rightSub[p], (long long)h[p] * (long long)(R[p] + 1 - l)));
+        for (size_t q = r; q > m; q = L[q] - 1) // [L[q], r]都不低于h[q]，左子树 [L[q], q-1] 在区间内
+            best = max(best, max(leftSub[q], (long long)h[q] * (long long)(r + 1 - L[q])));
+        return best;
+    }
+
+    /* 批量查询（离线），总时间 O((n + q) log^2 n)，与数据分布无关
+       [l, r]内的最优矩形以某根柱子k为最左最小值，其范围为 [max(L[k], l), min(R[k], r)]：
+       - 两端都被截断时k就是区间最小值位置，直接计算；
+       - 右端未截断（R[k] ≤ r）：按r递增扫描，加入R[k] ≤ r的柱子，面积是l的一次函数 h[k]*(R[k]+1-l)（l ≥ L[k]），
+         l ≤ L[k]时为常数 h[k]*(R[k]-L[k]+1)；
+       - 左端未截断（L[k] ≥ l）：按l递减对称处理，面积是r的一次函数
+       对 l > k（或 r < k）时直线给出的仍是合法矩形，所以只需按 L[k]（或 R[k]）分两段插入 */
+    vector<long long> queryBatch(const vector<pair<size_t, size_t>> &queries) const
+    {
+        size_t n = h.size(), q = queries.size();
+        vector<long long> ans(q, 0);
+        if (q == 0)
+            return ans;
+        for (size_t i = 0; i < q; ++i)
+        {
+            size_t l = queries[i].first, r = queries[i].second;
+            ans[i] = (long long)h[argmin(l, r)] * (long long)(r - l + 1);
+        }
+        vector<size_t> order(q), bars(n);
+        for (size_t i = 0; i < q; ++i)
+            order[i] = i;
+        for (size_t k = 0; k < n; ++k)
+            bars[k] = k;
+        LineMaxTree tree(n);
+
+        sort(order.begin(), order.end(), [&](size_t a, size_t b)
+             { return queries[a].second < queries[b].second; });
+        sort(bars.begin(), bars.end(), [&](size_t a, size_t b)
+             { return R[a] < R[b]; });
+        size_t next = 0;
+        for (size_t i : order)
+        {
+            for (; next < n && R[bars[next]] <= queries[i].second; ++next)
+            {
+                size_t k = bars[next];
+                long long hk = h[k];
+                if (L[k] > 0)
+                    tree.insert(0, L[k] - 1, 0, hk * (long long)(R[k] - L[k] + 1));
+                tree.insert(L[k], n - 1, -hk, hk * (long long)(R[k] + 1));
+            }
+            ans[i] = max(ans[i], tree.query(queries[i].first));
+        }
+
+        tree.reset();
+        sort(order.begin(), order.end(), [&](size_t a, size_t b)
+             { return queries[a].first > queries[b].first; });
+        sort(bars.begin(), bars.end(), [&](size_t a, size_t b)
+             { return L[a] > L[b]; });
+        next = 0;
+        for (size_t i : order)
+        {
+            for (; next < n && L[bars[next]] >= queries[i].first; ++next)
+            {
+                size_t k = bars[next];
+                long long hk = h[k];
+                tree.insert(0, R[k], hk, hk * (1 - (long long)L[k]));
+                if (R[k] + 1 < n)
+                    tree.insert(R[k] + 1, n - 1, 0, hk * (long long)(R[k] - L[k] + 1));
+            }
+            ans[i] = max(ans[i], tree.query(queries[i].second));
+        }
+        return ans;
+    }
+
+private:
+    vector<int> h;
+    vector<size_t> L, R;
+    vector<long long> leftSub, rightSub;
+    vector<vector<unsigned>> st;
+};
+
+/* 暴力枚举左右端点，用于校验 */
+long long bruteForce(const vector<int> &h)
+{
+    long long best = 0;
+    for (size_t l = 0; l < h.size(); ++l)
+    {
+        long long m = h[l];
+        for (size_t r = l; r < h.size(); ++r)
+        {
+            m = min(m, (long long)h[r]);
+            best = max(best, m * (long long)(r - l + 1));
+        }
+    }
+    return best;
+}
+
+/* 大规模测试：单调栈、并行分治、流式读文件三种方法结果一致，并比较用时 */
+void testLarge()
+{
+    const size_t N = 20000000;
+    int nThreads = max(4, (int)thread::hardware_concurrency());
+    vector<int> h(N);
+    for (int kind = 0; kind < 3; ++kind)
+    {
+        // 0：独立随机高度；1：随机游走（高大的矩形跨越多个分段）；2：单调递增（包络为整段）
+        unsigned seed = 2025;
+        long long walk = 1000000000;
+        for (size_t i = 0; i < N; ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+            if (kind == 0)
+                h[i] = (seed >> 8) % 100000;
+            else if (kind == 2)
+                h[i] = (int)(i / 4 + 1);
+            else
+            {
+                walk += (long long)((seed >> 8) % 2001) - 1000;
+                h[i] = (int)max(0LL, walk);
+            }
+        }
+        const char *names[] = {"随机高度", "随机游走", "单调递增"};
+        cout << names[kind] << "，n = " << N << endl;
+
+        clock_t start = clock();
+        long long a1 = largestRectangleArea(h);
+        double t1 = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        auto wall = chrono::steady_clock::now();
+        long long a2 = largestRectangleParallel(h.data(), N, nThreads);
+        double t2 = chrono::duration<double>(chrono::steady_clock::now() - wall).count();
+
+        FILE *f = tmpfile();
+        double t3 = 0;
+        long long a3 = -1, cnt = 0;
+        if (f != NULL)
+        {
+            fwrite(h.data(), sizeof(int), N, f);
+            rewind(f);
+            start = clock();
+            a3 = largestRectangleFromFile(f, &cnt);
+            t3 = (double)(clock() - start) / CLOCKS_PER_SEC;
+            fclose(f);
+        }
+        cout << "  单调栈：" << a1 << "，" << t1 << " 秒" << endl;
+        cout << "  并行（" << nThreads << " 线程）：" << a2 << "，" << t2 << " 秒" << (a2 == a1 ? "" : "（结果不一致）") << endl;
+        cout << "  流式读文件：" << a3 << "，" << t3 << " 秒，读入 " << cnt << " 个" << (a3 == a1 ? "" : "（结果不一致）") << endl;
+    }
+}
+
+void testMatrix()
+{
+    // 小矩阵：逐行朴素计算高度再暴力求解，校验按字节、按位、按带并行三种方式
+    bool ok = true;
+    for (int t = 0; t < 200; ++t)
+    {
+        size_t R = randInt(1, 150), C = randInt(1, 150), W = (C + 63) / 64;
+        int density = randInt(1, 10); // 0的比例约为 1/(density+1)
+        vector<unsigned char> a(R * C);
+        vector<uint64_t> bits(R * W, 0);
+        for (size_t i = 0; i < R * C; ++i)
+            a[i] = rand() % (density + 1) != 0;
+        for (size_t r = 0; r < R; ++r)
+            for (size_t c = 0; c < C; ++c)
+                if (a[r * C + c])
+                    bits[r * W + c / 64] |= 1ULL << (c % 64);
+        long long expect = 0;
+        vector<int> h(C, 0);
+        MaximalRectangle byByte(C), byBit(C);
+        for (size_t r = 0; r < R; ++r)
+        {
+            for (size_t c = 0; c < C; ++c)
+                h[c] = a[r * C + c] ? h[c] + 1 : 0;
+            expect = max(expect, bruteForce(h));
+            byByte.addRow(&a[r * C]);
+            byBit.addRow(&bits[r * W]);
+        }
+        if (byByte.result() != expect || byBit.result() != expect || maximalRectangle(bits.data(), R, C, W, 3) != expect)
+            ok = false;
+    }
+    cout << "二维随机测试：" << (ok ? "全部正确" : "结果不一致") << endl;
+
+    // 大矩阵：按位压缩的 8192 x 8192，随机障碍
+    const size_t R = 8192, C = 8192, W = C / 64;
+    vector<uint64_t> bits(R * W, ~0ULL);
+    unsigned seed = 7;
+    for (size_t k = 0; k < R * C / 200; ++k)
+    {
+        seed = seed * 1103515245 + 12345;
+        size_t r = (seed >> 4) % R;
+        seed = seed * 1103515245 + 12345;
+        size_t c = (seed >> 4) % C;
+        bits[r * W + c / 64] &= ~(1ULL << (c % 64));
+    }
+    int nThreads = max(4, (int)thread::hardware_concurrency());
+    cout << "二维矩阵 " << R << " x " << C << endl;
+
+    clock_t start = clock();
+    MaximalRectangle mr(C);
+    for (size_t r = 0; r < R; ++r)
+        mr.addRow(&bits[r * W]);
+    double t1 = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    auto wall = chrono::steady_clock::now();
+    long long a2 = maximalRectangle(bits.data(), R, C, W, nThreads);
+    double t2 = chrono::duration<double>(chrono::steady_clock::now() - wall).count();
+    cout << "  逐行：" << mr.result() << "，" << t1 << " 秒" << endl;
+    cout << "  按带并行（" << nThreads << " 线程）：" << a2 << "，" << t2 << " 秒" << (a2 == mr.result() ? "" : "（结果不一致）") << endl;
+}
+
+void testRange()
+{
+    // 小数组：所有区间与暴力解法比较（含单调数组，链最长）
+    bool ok = true;
+    for (int t = 0; t < 60; ++t)
+    {
+        int n = randInt(1, 60);
+        vector<int> h(n);
+        for (int i = 0; i < n; ++i)
+            h[i] = t % 10 == 0 ? i : t % 10 == 1 ? n - i : randInt(0, t % 3 == 0 ? 3 : 100);
+        RangeRectangle rr(h);
+        vector<pair<size_t, size_t>> qs;
+        for (int l = 0; l < n; ++l)
+            for (int r = l; r < n; ++r)
+                qs.push_back(make_pair((size_t)l, (size_t)r));
+        vector<long long> batch = rr.queryBatch(qs);
+        for (size_t i = 0; i < qs.size(); ++i)
+        {
+            vector<int> part(h.begin() + qs[i].first, h.begin() + qs[i].second + 1);
+            long long expect = bruteForce(part);
+            if (batch[i] != expect || rr.query(qs[i].first, qs[i].second) != expect)
+                ok = false;
+        }
+    }
+    cout << "区间查询随机测试：" << (ok ? "全部正确" : "结果不一致") << endl;
+
+    const size_t N = 500000, Q = 100000, SCAN = 1000;
+    vector<int> h(N);
+    unsigned seed = 99;
+    for (size_t i = 0; i < N; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        h[i] = (seed >> 8) % 100000;
+    }
+    vector<pair<size_t, size_t>> qs(Q);
+    for (size_t i = 0; i < Q; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        size_t a = (seed >> 4) % N;
+        seed = seed * 1103515245 + 12345;
+        size_t b = (seed >> 4) % N;
+        qs[i] = make_pair(min(a, b), max(a, b));
+    }
+    cout << "区间查询：n = " << N << "，q = " << Q << endl;
+
+    clock_t start = clock();
+    RangeRectangle rr(h);
+    double tBuild = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    vector<long long> single(Q);
+    for (size_t i = 0; i < Q; ++i)
+        single[i] = rr.query(qs[i].first, qs[i].second);
+    double tQuery = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    vector<long long> batch = rr.queryBatch(qs);
+    double tBatch = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    // 逐个扫描太慢，只做前SCAN个，按比例估算
+    start = clock();
+    vector<size_t> stk;
+    bool same = single == batch;
+    for (size_t i = 0; i < SCAN; ++i)
+        if (largestRectangleArea(h.data() + qs[i].first, qs[i].second - qs[i].first + 1, stk) != batch[i])
+            same = false;
+    double tScan = (double)(clock() - start) / CLOCKS_PER_SEC * Q / SCAN;
+
+    cout << "  预处理：" << tBuild << " 秒" << endl;
+    cout << "  逐个查询：" << tQuery << " 秒" << endl;
+    cout << "  批量查询：" << tBatch << " 秒" << endl;
+    cout << "  逐个 O(n) 扫描（估算）：" << tScan << " 秒" << (same ? "" : "（结果不一致）") << endl;
+
+    // 单调递增：最小值链最长的情形，逐个查询与直接扫描比较
+    for (size_t i = 0; i < N; ++i)
+        h[i] = (int)i;
+    RangeRectangle mono(h);
+    start = clock();
+    long long sum1 = 0;
+    for (size_t i = 0; i < SCAN; ++i)
+        sum1 += mono.query(qs[i].first, qs[i].second);
+    double tMono = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    long long sum2 = 0;
+    for (size_t i = 0; i < SCAN; ++i)
+        sum2 += largestRectangleArea(h.data() + qs[i].first, qs[i].second - qs[i].first + 1, stk);
+    tScan = (double)(clock() - start) / CLOCKS_PER_SEC;
+    cout << "  单调数组 " << SCAN << " 次查询：逐个查询 " << tMono << " 秒，O(n) 扫描 " << tScan << " 秒"
+         << (sum1 == sum2 ? "" : "（结果不一致）") << endl;
+}
+
+void testInput()
+{
+    // 扫描正确性：随机整数（含负数与极值）、随机分隔符，整体扫描与按很小的块分段读入都要还原出原数组
+    string text;
+    vector<int> expect;
+    const char *seps[] = {" ", ",", ", ", "\n", "\r\n", "\t", "[", "]", "  ,  "};
+    for (int i = 0; i < 20000; ++i)
+    {
+        int v = i % 997 == 0 ? (i % 2 ? INT_MAX : INT_MIN) : randInt(-100000, 100000);
+        expect.push_back(v);
+        text += to_string(v);
+        text += seps[rand() % 9];
+    }
+    vector<int> got1, got2;
+    scanIntegers(text.data(), text.data() + text.size(), true, [&](const int *v, size_t k)
+                 { got1.insert(got1.end(), v, v + k); });
+    FILE *f = tmpfile();
+    if (f != NULL)
+    {
+        fwrite(text.data(), 1, text.size(), f);
+        rewind(f);
+        scanIntegers(f, [&](const int *v, size_t k)
+                     { got2.insert(got2.end(), v, v + k); }, 7);
+        fclose(f);
+    }
+    cout << "整数扫描测试：" << (got1 == expect && got2 == expect ? "全部正确" : "结果不一致") << endl;
+
+    // 大文件：文本与二进制各写一份，比较逐个fscanf与映射扫描
+    const size_t N = 10000000;
+    string txtPath = (filesystem::temp_directory_path() / "rect_input.txt").string();
+    string binPath = (filesystem::temp_directory_path() / "rect_input.bin").string();
+    FILE *ft = fopen(txtPath.c_str(), "wb"), *fb = fopen(binPath.c_str(), "wb");
+    if (ft == NULL || fb == NULL)
+    {
+        cout << "无法创建临时文件，跳过大文件测试" << endl;
+        if (ft != NULL)
+            fclose(ft);
+        if (fb != NULL)
+            fclose(fb);
+        return;
+    }
+    vector<int> h(N);
+    unsigned seed = 31;
+    for (size_t i = 0; i < N; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        h[i] = (seed >> 8) % 100000;
+        fprintf(ft, i + 1 < N ? "%d, " : "%d\n", h[i]);
+    }
+    fwrite(h.data(), sizeof(int), N, fb);
+    fclose(ft);
+    fclose(fb);
+    long long expectArea = largestRectangleArea(h);
+    cout << "大文件输入，n = " << N << endl;
+
+    clock_t start = clock();
+    RectangleStream rs;
+    ft = fopen(txtPath.c_str(), "rb");
+    int v;
+    while (fscanf(ft, "%d%*[^-0-9]", &v) == 1)
+        rs.push(v);
+    fclose(ft);
+    double t0 = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    long long cnt1 = 0, cnt2 = 0;
+    start = clock();
+    long long a1 = largestRectangleFromText(txtPath.c_str(), &cnt1);
+    double t1 = (double)(clock() - start) / CLOCKS_PER_SEC;
+    start = clock();
+    long long a2 = largestRectangleFromBinary(binPath.c_str(), &cnt2);
+    double t2 = (double)(clock() - start) / CLOCKS_PER_SEC;
+    remove(txtPath.c_str());
+    remove(binPath.c_str());
+
+    cout << "  文本，逐个fscanf：" << rs.result() << "，" << t0 << " 秒" << endl;
+    cout << "  文本，映射扫描：" << a1 << "，" << t1 << " 秒，读入 " << cnt1 << " 个"
+         << (a1 == expectArea && rs.result() == expectArea ? "" : "（结果不一致）") << endl;
+    cout << "  二进制，映射：" << a2 << "，" << t2 << " 秒，读入 " << cnt2 << " 个" << (a2 == expectArea ? "" : "（结果不一致）") << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    // 文件模式：--text 文件 或 --binary 文件
+    if (argc >= 3 && (strcmp(argv[1], "--text") == 0 || strcmp(argv[1], "--binary") == 0))
+    {
+        long long cnt = 0;
+        clock_t start = clock();
+        long long area = strcmp(argv[1], "--text") == 0 ? largestRectangleFromText(argv[2], &cnt)
+                                                         : largestRectangleFromBinary(argv[2], &cnt);
+        if (area < 0)
+        {
+            cerr << "无法打开文件" << endl;
+            return 1;
+        }
+        cout << "最大矩形面积 = " << area << endl;
+        cerr << cnt << " 个柱子，用时 " << (double)(clock() - start) / CLOCKS_PER_SEC << " 秒" << endl;
+        return 0;
+    }
     srand((unsigned)time(NULL));
     const int TEST_CASES = 10;
     cout << "随机测试开始" << endl;
@@ -46,56 +1090,33 @@ int main()
         cout << "， 生成的数组中的数：";
         for (size_t i = 0; i < heights.size(); ++i)
             cout << heights[i] << " ";
-        cout << "，最大矩形面积 = " << largestRectangleArea(heights) << endl;
+        long long area = largestRectangleArea(heights);
+        RectangleStream rs;
+        rs.push(heights.data(), heights.size());
+        cout << "，最大矩形面积 = " << area;
+        if (area != bruteForce(heights) || area != rs.result())
+            cout << "（与暴力解法或流式结果不一致）";
+        cout << endl;
     }
     cout << "随机测试结束" << endl;
+    testLarge();
+    testMatrix();
+    testRange();
+    testInput();
     cout << "请输入高度数组 heights=[ ]" << endl;
     string line;
     getline(cin, line);
     vector<int> heights;
-    int num = 0;
-    bool inNum = false;
-    bool neg = false;
-    for (int i = 0; i < (int)line.size(); ++i)
-    {
-        char c = line[i];
-        if (c == '[')
-        {
-            inNum = false;
-            continue;
-        }
-        if (c == ']')
-            break;
-        if (isdigit(c))
-        {
-            num = num * 10 + (c - '0');
-            inNum = true;
-        }
-        else if (c == ',' || c == ' ')
-        {
-            if (inNum)
-            {
-                if (neg)
-                    num = -num;
-                heights.push_back(num);
-                num = 0;
-                neg = false;
-                inNum = false;
-            }
-        }
-    }
-    if (inNum) // 最后一个数字
-    {
-        if (neg)
-            num = -num;
-        heights.push_back(num);
-    }
+    size_t close = line.find(']'); // ']'之后的内容忽略
+    const char *end = line.data() + (close == string::npos ? line.size() : close);
+    scanIntegers(line.data(), end, true, [&](const int *v, size_t k)
+                 { heights.insert(heights.end(), v, v + k); });
     if (heights.empty())
     {
         cout << "未读到任何高度，程序退出。" << endl;
         return 0;
     }
-    int area = largestRectangleArea(heights);
+    long long area = largestRectangleArea(heights);
     cout << "输出：" << area << endl;
     return 0;
 }